@@ -0,0 +1,99 @@
+/* @file btype_memory_bench.cpp
+   @brief Benchmark of the memory used per type, for each kind of type.
+
+   Usage: btype_memory_bench [number of types per kind]
+
+   Live bytes are tracked by replacing the global operator new and delete.
+   The bytes per type are the bytes still allocated once the types are
+   created: the node, its shared_ptr control block and its share of the
+   factory tables (hash table entries, buckets, index). Freed temporaries
+   are not counted.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "btype.h"
+
+static std::atomic<size_t> live{0};
+
+// Each block is preceded by its size, so that delete can subtract it
+static constexpr size_t header = alignof(std::max_align_t);
+
+void *operator new(size_t size) {
+  if (void *p = std::malloc(header + size)) {
+    *static_cast<size_t *>(p) = size;
+    live += size;
+    return static_cast<char *>(p) + header;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept {
+  if (p == nullptr) return;
+  void *block = static_cast<char *>(p) - header;
+  live -= *static_cast<size_t *>(block);
+  std::free(block);
+}
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+// Creates n types with f and prints the live bytes per type
+static void measure(const char *kind, size_t nodeSize, size_t n,
+                    const std::function<void(size_t)> &f) {
+  const size_t before = live;
+  for (size_t i = 0; i < n; ++i) f(i);
+  const double perType = static_cast<double>(live - before) / n;
+  std::printf("%-14s %10zu %14.1f\n", kind, nodeSize, perType);
+}
+
+int main(int argc, char **argv) {
+  const size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  // Create the basic types first, so that they are not counted
+  auto intType = BTypeFactory::Integer();
+  std::printf("%zu types per kind\n%-14s %10s %14s\n", n, "kind",
+              "sizeof node", "bytes/type");
+  std::printf("%-14s %10zu\n", "basic", sizeof(BType));
+
+  std::shared_ptr<BType> t = intType;
+  measure("Product", sizeof(BType::ProductType), n,
+          [&](size_t) { t = BTypeFactory::Product(t, intType); });
+  t = intType;
+  measure("PowerSet", sizeof(BType::PowerType), n,
+          [&](size_t) { t = BTypeFactory::PowerSet(t); });
+
+  // Names are built beforehand, so that only the types are counted
+  std::vector<std::string> names;
+  names.reserve(n);
+  for (size_t i = 0; i < n; ++i) names.push_back("S" + std::to_string(i));
+  std::vector<std::shared_ptr<BType>> sets;
+  sets.reserve(n);
+  measure("AbstractSet", sizeof(BType::AbstractSet), n, [&](size_t i) {
+    sets.push_back(BTypeFactory::AbstractSet(names[i]));
+  });
+  for (auto &name : names) name[0] = 'E';
+  const std::vector<std::string> values{"a", "b"};
+  measure("EnumeratedSet", sizeof(BType::EnumeratedSet), n,
+          [&](size_t i) { BTypeFactory::EnumeratedSet(names[i], values); });
+  measure("Struct", sizeof(BType::StructType), n,
+          [&](size_t i) { BTypeFactory::Struct({{"f", sets[i]}}); });
+  return 0;
+}
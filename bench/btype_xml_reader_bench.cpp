@@ -0,0 +1,88 @@
+/* @file btype_xml_reader_bench.cpp
+   @brief Benchmark of BTypeFactory::buildFromXML on a large generated
+   RichTypesInfo document, for several numbers of threads.
+
+   Usage: btype_xml_reader_bench [number of entries] [thread counts...]
+
+   The type table is global to the process and can only grow, so each
+   measurement is done in a child process starting from an empty table.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "btype.h"
+#include "btype_xml_generator.h"
+#include "tinyxml2.h"
+
+int main(int argc, char **argv) {
+  const size_t nbTypes =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  std::vector<unsigned> threadCounts;
+  for (int i = 2; i < argc; ++i)
+    threadCounts.push_back(std::strtoul(argv[i], nullptr, 10));
+  if (threadCounts.empty()) threadCounts = {1, 2, 4, 8};
+
+  const std::string xml = generateRichTypesInfo(nbTypes);
+  tinyxml2::XMLDocument doc;
+  if (doc.Parse(xml.c_str(), xml.size()) != tinyxml2::XML_SUCCESS) {
+    std::fprintf(stderr, "parse error: %s\n", doc.ErrorStr());
+    return 1;
+  }
+  const tinyxml2::XMLElement *root = doc.FirstChildElement("RichTypesInfo");
+
+  std::printf("%zu entries\n%8s %12s %16s %8s\n", nbTypes, "threads",
+              "time (ms)", "entries/s", "speedup");
+  std::fflush(stdout);
+  double reference = 0.0;
+  for (unsigned nbThreads : threadCounts) {
+    int fds[2];
+    if (pipe(fds) != 0) return 1;
+    const pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      const auto start = std::chrono::steady_clock::now();
+      BTypeFactory::buildFromXML(root, nbThreads);
+      const std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      const double ms = elapsed.count();
+      if (write(fds[1], &ms, sizeof ms) != sizeof ms) _exit(1);
+      _exit(0);
+    }
+    close(fds[1]);
+    double ms = 0.0;
+    const bool ok = read(fds[0], &ms, sizeof ms) == sizeof ms;
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!ok || status != 0) {
+      std::fprintf(stderr, "measurement with %u threads failed\n", nbThreads);
+      return 1;
+    }
+    if (reference == 0.0) reference = ms;
+    std::printf("%8u %12.1f %16.0f %8.2f\n", nbThreads, ms,
+                nbTypes / (ms / 1000.0), reference / ms);
+    std::fflush(stdout);
+  }
+  return 0;
+}
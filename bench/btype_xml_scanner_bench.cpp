@@ -0,0 +1,83 @@
+/* @file btype_xml_scanner_bench.cpp
+   @brief Benchmark of the throughput of the RichTypesInfo scanner, compared
+   to parsing the same document with tinyxml2.
+
+   Usage: btype_xml_scanner_bench [number of entries] [repetitions]
+
+   Only the reading of the document is measured: neither reader creates
+   types, so the global type table is left untouched.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "btype_rich_types_info.h"
+#include "btype_xml_generator.h"
+#include "tinyxml2.h"
+
+// Returns the best time of a number of runs of f, in seconds
+template <typename F>
+static double best(unsigned repetitions, F &&f) {
+  double result = 0.0;
+  for (unsigned i = 0; i < repetitions; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (i == 0 || elapsed.count() < result) result = elapsed.count();
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  const size_t nbTypes =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  const unsigned repetitions =
+      argc > 2 ? std::max(1ul, std::strtoul(argv[2], nullptr, 10)) : 5;
+
+  const std::string xml = generateRichTypesInfo(nbTypes);
+  const double megabytes = xml.size() / 1e6;
+  std::printf("%zu entries, %.1f MB\n%10s %12s %10s\n", nbTypes, megabytes,
+              "reader", "time (ms)", "GB/s");
+
+  size_t nbRecords = 0;
+  const double scan = best(repetitions, [&] {
+    nbRecords = richTypesInfo::scan(xml).size();
+  });
+  if (nbRecords != nbTypes) {
+    std::fprintf(stderr, "scan returned %zu records\n", nbRecords);
+    return 1;
+  }
+  std::printf("%10s %12.1f %10.3f\n", "scan", scan * 1e3,
+              megabytes / 1e3 / scan);
+
+  bool ok = true;
+  const double dom = best(repetitions, [&] {
+    tinyxml2::XMLDocument doc;
+    ok = ok && doc.Parse(xml.c_str(), xml.size()) == tinyxml2::XML_SUCCESS;
+  });
+  if (!ok) {
+    std::fprintf(stderr, "tinyxml2 parse error\n");
+    return 1;
+  }
+  std::printf("%10s %12.1f %10.3f\n", "tinyxml2", dom * 1e3,
+              megabytes / 1e3 / dom);
+  return 0;
+}
@@ -21,94 +21,138 @@
 #include <unordered_map>
 
 namespace hashUtil {
+inline size_t combine(size_t seed, size_t value) {
+  return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
 inline size_t hash_combine_string(const std::string& str, size_t seed) {
-  return seed ^ (std::hash<std::string>{}(str) + 0x9e3779b9 + (seed << 6) +
-                 (seed >> 2));
+  return combine(seed, std::hash<std::string>{}(str));
 }
 }  // namespace hashUtil
 
 // Type conversion methods
-std::shared_ptr<const BType::ProductType> BType::toProductType() const {
+const BType::ProductType* BType::asProductType() const {
   if (m_kind != Kind::ProductType) return nullptr;
-  return std::dynamic_pointer_cast<const ProductType>(this->shared_from_this());
+  return static_cast<const ProductType*>(this);
 }
 
-std::shared_ptr<const BType::PowerType> BType::toPowerType() const {
+const BType::PowerType* BType::asPowerType() const {
   if (m_kind != Kind::PowerType) return nullptr;
-  return std::dynamic_pointer_cast<const PowerType>(this->shared_from_this());
+  return static_cast<const PowerType*>(this);
 }
 
-std::shared_ptr<const BType::AbstractSet> BType::toAbstractSetType() const {
+const BType::AbstractSet* BType::asAbstractSetType() const {
   if (m_kind != Kind::AbstractSet) return nullptr;
-  return std::dynamic_pointer_cast<const AbstractSet>(shared_from_this());
+  return static_cast<const AbstractSet*>(this);
 }
 
-std::shared_ptr<const BType::EnumeratedSet> BType::toEnumeratedSetType() const {
+const BType::EnumeratedSet* BType::asEnumeratedSetType() const {
   if (m_kind != Kind::EnumeratedSet) return nullptr;
-  return std::dynamic_pointer_cast<const EnumeratedSet>(shared_from_this());
+  return static_cast<const EnumeratedSet*>(this);
 }
 
-std::shared_ptr<const BType::StructType> BType::toStructType() const {
+const BType::StructType* BType::asStructType() const {
   if (m_kind != Kind::Struct) return nullptr;
-  return std::dynamic_pointer_cast<const StructType>(shared_from_this());
+  return static_cast<const StructType*>(this);
+}
+
+namespace {
+// Shares the ownership of the table entry of a type. A type that is not in
+// the table has no owner to share.
+template <typename T>
+std::shared_ptr<const T> share(const BType& type, const T* converted) {
+  if (!converted || type.index() == SIZE_MAX) {
+    return std::shared_ptr<const T>(std::shared_ptr<const T>(), converted);
+  }
+  return std::shared_ptr<const T>(BTypeFactory::at(type.index()), converted);
+}
+}  // namespace
+
+std::shared_ptr<const BType::ProductType> BType::toProductType() const {
+  return share(*this, asProductType());
+}
+
+std::shared_ptr<const BType::PowerType> BType::toPowerType() const {
+  return share(*this, asPowerType());
+}
+
+std::shared_ptr<const BType::AbstractSet> BType::toAbstractSetType() const {
+  return share(*this, asAbstractSetType());
+}
+
+std::shared_ptr<const BType::EnumeratedSet> BType::toEnumeratedSetType() const {
+  return share(*this, asEnumeratedSetType());
+}
+
+std::shared_ptr<const BType::StructType> BType::toStructType() const {
+  return share(*this, asStructType());
 }
 
 int BType::compare(const BType& v1, const BType& v2) {
-  size_t hash1 = v1.hash_combine(0);
-  size_t hash2 = v2.hash_combine(0);
+  size_t hash1 = v1.hash();
+  size_t hash2 = v2.hash();
   if (hash1 < hash2) return -1;
   if (hash1 > hash2) return 1;
   return 0;
 }
 
 size_t BType::hash_combine(size_t seed) const {
-  switch (m_kind) {
+  return hashUtil::combine(seed, m_hash);
+}
+
+size_t BType::kindHash(Kind kind) {
+  switch (kind) {
     case Kind::INTEGER:
-      return hashUtil::hash_combine_string("INTEGER", seed);
+      return hashUtil::hash_combine_string("INTEGER", 0);
     case Kind::BOOLEAN:
-      return hashUtil::hash_combine_string("BOOLEAN", seed);
+      return hashUtil::hash_combine_string("BOOLEAN", 0);
     case Kind::FLOAT:
-      return hashUtil::hash_combine_string("FLOAT", seed);
+      return hashUtil::hash_combine_string("FLOAT", 0);
     case Kind::REAL:
-      return hashUtil::hash_combine_string("REAL", seed);
+      return hashUtil::hash_combine_string("REAL", 0);
     case Kind::STRING:
-      return hashUtil::hash_combine_string("STRING", seed);
+      return hashUtil::hash_combine_string("STRING", 0);
     case Kind::ProductType:
-      return toProductType()->hash_combine(seed);
+      return hashUtil::hash_combine_string("*", 0);
     case Kind::PowerType:
-      return toPowerType()->hash_combine(seed);
+      return hashUtil::hash_combine_string("POW", 0);
     case Kind::AbstractSet:
-      return toAbstractSetType()->hash_combine(seed);
     case Kind::EnumeratedSet:
-      return toEnumeratedSetType()->hash_combine(seed);
+      return hashUtil::hash_combine_string("SET", 0);
     case Kind::Struct:
-      return toStructType()->hash_combine(seed);
+      return hashUtil::hash_combine_string("struct", 0);
   }
   // Should never reach here
-  return seed;
-}
-
-size_t BType::ProductType::hash_combine(size_t seed) const {
-  return lhs->hash_combine(rhs->hash_combine(seed));
-}
-
-size_t BType::PowerType::hash_combine(size_t seed) const {
-  return hashUtil::hash_combine_string("POW", m_content->hash_combine(seed));
-}
-
-size_t BType::AbstractSet::hash_combine(size_t seed) const {
-  return hashUtil::hash_combine_string(m_name, seed);
-}
-
-size_t BType::EnumeratedSet::hash_combine(size_t seed) const {
-  return hashUtil::hash_combine_string(m_name, seed);
+  return 0;
 }
 
-size_t BType::StructType::hash_combine(size_t seed) const {
-  size_t res = seed;
-  for (auto& p : m_fields)
-    res = hashUtil::hash_combine_string(p.first, p.second->hash_combine(res));
-  return res;
+// Only reads the hashes of the sub-types, so that creating a type takes
+// constant time in the size of its tree.
+size_t BType::structuralHash() const {
+  size_t res = kindHash(m_kind);
+  switch (m_kind) {
+    case Kind::ProductType: {
+      const auto& product = static_cast<const ProductType&>(*this);
+      return hashUtil::combine(hashUtil::combine(res, product.lhs->m_hash),
+                               product.rhs->m_hash);
+    }
+    case Kind::PowerType:
+      return hashUtil::combine(
+          res, static_cast<const PowerType&>(*this).m_content->m_hash);
+    case Kind::AbstractSet:
+      return hashUtil::hash_combine_string(
+          static_cast<const AbstractSet&>(*this).m_name, res);
+    case Kind::EnumeratedSet:
+      return hashUtil::hash_combine_string(
+          static_cast<const EnumeratedSet&>(*this).m_name, res);
+    case Kind::Struct:
+      for (auto& p : static_cast<const StructType&>(*this).m_fields) {
+        res = hashUtil::combine(hashUtil::hash_combine_string(p.first, res),
+                                p.second->m_hash);
+      }
+      return res;
+    default:
+      return res;
+  }
 }
 
 std::vector<std::pair<std::string, std::shared_ptr<BType>>>
@@ -120,7 +164,7 @@ BType::StructType::sort(
   return sorted_fields;
 }
 
-// Definition of the virtual accept function
+// Definition of the accept function
 void BType::accept(Visitor& v) const {
   switch (m_kind) {
     case Kind::INTEGER:
@@ -139,19 +183,19 @@ void BType::accept(Visitor& v) const {
       v.visitSTRING();
       break;
     case Kind::ProductType:
-      toProductType()->accept(v);
+      static_cast<const ProductType&>(*this).accept(v);
       break;
     case Kind::PowerType:
-      toPowerType()->accept(v);
+      static_cast<const PowerType&>(*this).accept(v);
       break;
     case Kind::AbstractSet:
-      toAbstractSetType()->accept(v);
+      static_cast<const AbstractSet&>(*this).accept(v);
       break;
     case Kind::EnumeratedSet:
-      toEnumeratedSetType()->accept(v);
+      static_cast<const EnumeratedSet&>(*this).accept(v);
       break;
     case Kind::Struct:
-      toStructType()->accept(v);
+      static_cast<const StructType&>(*this).accept(v);
       break;
   }
 }
@@ -20,9 +20,12 @@
 #define BTYPE_H
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <exception>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -47,15 +50,22 @@ class BTypeCache;
  * Types are internally represented in a table. The index of the type in
  * the table may be queried using the BType::index() method, and it is possible
  * get the type at a given index using the BTypeFactory::at() method.
+ *
+ * The common part of a type is 16 bytes: its kind, its index and its hash,
+ * computed once at creation from the hashes of its sub-types. There is no
+ * virtual table: functions depending on the kind switch on it, and types are
+ * only destroyed through the std::shared_ptr that created them. The
+ * constructors are private and the destructor is protected, so that types
+ * can neither be created nor deleted outside the factory.
  */
-class BType : public std::enable_shared_from_this<BType> {
+class BType {
  public:
   /* @brief Enumeration of the different kinds of types.
    *
    * This enumeration lists the different kinds of types that can be represented
    * by the BType class.
    */
-  enum class Kind {
+  enum class Kind : uint8_t {
     INTEGER,
     BOOLEAN,
     FLOAT,
@@ -83,6 +93,11 @@ class BType : public std::enable_shared_from_this<BType> {
   /** @brief converts to a ProductType, if possible
    * @return a shared pointer to the ProductType, or nullptr if the conversion
    * is not possible
+   * @note For a type of the BTypeFactory table, the returned pointers of the
+   * conversions share the ownership of the table entry, which is kept until
+   * the end of the program. A type outside the table, such as a type of a
+   * BTypeStaging builder, has no owner to share: the returned pointer is
+   * valid as long as the type is.
    */
   std::shared_ptr<const ProductType> toProductType() const;
   /** @brief converts to a PowerType, if possible
@@ -106,6 +121,24 @@ class BType : public std::enable_shared_from_this<BType> {
    */
   std::shared_ptr<const EnumeratedSet> toEnumeratedSetType() const;
 
+  /** @brief converts to a ProductType, if possible, without sharing ownership
+   * @return a pointer to the ProductType, or nullptr if the conversion is not
+   * possible
+   * @note Unlike the toX() conversions, the asX() conversions take no lock:
+   * the returned pointers are valid as long as the type is.
+   */
+  const ProductType *asProductType() const;
+  /** @brief converts to a PowerType, if possible, without sharing ownership */
+  const PowerType *asPowerType() const;
+  /** @brief converts to a Struct, if possible, without sharing ownership */
+  const StructType *asStructType() const;
+  /** @brief converts to an AbstractSet, if possible, without sharing
+   * ownership */
+  const AbstractSet *asAbstractSetType() const;
+  /** @brief converts to an EnumeratedSet, if possible, without sharing
+   * ownership */
+  const EnumeratedSet *asEnumeratedSetType() const;
+
   /**
    * @brief Abstract visitor class for the BType hierarchy.
    *
@@ -124,7 +157,16 @@ class BType : public std::enable_shared_from_this<BType> {
     virtual void visitPowerType(const PowerType &) = 0;
     virtual void visitStructType(const StructType &) = 0;
   };
-  virtual void accept(Visitor &v) const;
+  void accept(Visitor &v) const;
+
+  /**
+   * @brief Applies a function to each direct sub-type of this BType.
+   * @param f A callable taking a const std::shared_ptr<BType> &. It is called
+   * on the left then right operand of a product, on the content of a power
+   * set and on the field types of a struct, in field order.
+   */
+  template <typename F>
+  void forEachChild(F &&f) const;
 
   // Comparisons
   static int compare(const BType &v1, const BType &v2);
@@ -154,56 +196,102 @@ class BType : public std::enable_shared_from_this<BType> {
    * @param seed The initial seed value.
    * @return The combined hash value.
    */
-  virtual size_t hash_combine(size_t seed) const;
+  size_t hash_combine(size_t seed) const;
 
   friend class BTypeFactory;
   friend class BTypeCache;
+  friend class BTypeStaging;
+  friend class BTypeAudit;
 
-  /**
-   * @brief Constructor for BType. Only BTypeFactory can create
-   * instances.
-   * @param kind The kind of BType to create.
-   */
-  BType(Kind kind)
-      : m_kind{kind}, m_index{SIZE_MAX}, m_hash_valid(false), m_hash(0) {};
-  virtual ~BType() = default;
   /**
    * @brief Gets the hash value of the BType.
    * @return The hash value.
-   * @note The hash is computed lazily and cached.
+   * @note The hash is computed at creation.
    */
-  size_t hash() const {
-    if (!m_hash_valid) {
-      m_hash = hash_combine(0);
-      m_hash_valid = true;
-    }
-    return m_hash;
-  }
+  size_t hash() const { return m_hash; }
 
   /** @bref Gets the position in the BTypeFactory table
-   * @return The index of the BType in the BTypeFactory table
+   * @return The index of the BType in the BTypeFactory table, or SIZE_MAX if
+   * the BType is not in the table
    *
    * The index matches the creation order.
    */
-  size_t index() const { return m_index; }
+  size_t index() const { return m_index == noIndex ? SIZE_MAX : m_index; }
+
+ protected:
+  /**
+   * @brief Constructor for BType. Only BTypeFactory can create
+   * instances.
+   * @param kind The kind of BType to create.
+   */
+  BType(Kind kind) : m_kind{kind}, m_hash{kindHash(kind)} {};
+  /**
+   * @brief Destructor. It is not virtual, so it is protected: a type cannot
+   * be deleted through a pointer to BType.
+   */
+  ~BType() = default;
 
  private:
+  /**
+   * @brief Allocator through which std::allocate_shared constructs and
+   * destroys the types, whose constructors are private. The type and its
+   * control block are allocated together, as with std::make_shared.
+   */
+  template <typename T>
+  struct Allocator {
+    using value_type = T;
+    Allocator() = default;
+    template <typename U>
+    Allocator(const Allocator<U> &) {}
+    T *allocate(size_t n) { return std::allocator<T>().allocate(n); }
+    void deallocate(T *p, size_t n) { std::allocator<T>().deallocate(p, n); }
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&...args) {
+      ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+    }
+    template <typename U>
+    void destroy(U *p) {
+      p->~U();
+    }
+    template <typename U>
+    bool operator==(const Allocator<U> &) const {
+      return true;
+    }
+    template <typename U>
+    bool operator!=(const Allocator<U> &) const {
+      return false;
+    }
+  };
+  /**
+   * @brief Creates a type. Used by BTypeFactory, BTypeCache and BTypeStaging.
+   * @tparam T BType or one of its nested classes
+   * @param args the arguments of the constructor of T
+   */
+  template <typename T, typename... Args>
+  static std::shared_ptr<T> make(Args &&...args) {
+    return std::allocate_shared<T>(Allocator<T>(), std::forward<Args>(args)...);
+  }
+
   /** @brief Deleted copy constructor to prevent copying. */
   BType(const BType &) = delete;
   /** @brief Deleted assignment operator to prevent assignment. */
   BType &operator=(const BType &) = delete;
+  /**
+   * @brief Computes the hash value from the kind, the names and the hashes of
+   * the sub-types.
+   */
+  size_t structuralHash() const;
+  /** @brief Computes the part of the hash value that depends on the kind. */
+  static size_t kindHash(Kind kind);
+
+  /** @brief Value of m_index for a BType not in the table. */
+  static constexpr uint32_t noIndex = UINT32_MAX;
   /** @brief The kind of BType. */
   Kind m_kind;
-
- protected:
   /** @brief The position of the BType in the BTypeFactory table */
-  size_t m_index;
-
- private:
-  /** @brief Flag to indicate if the hash value is valid. */
-  mutable bool m_hash_valid = false;
-  /** @brief Cached hash value. */
-  mutable size_t m_hash;
+  uint32_t m_index = noIndex;
+  /** @brief Hash value, set by the constructors. */
+  size_t m_hash;
 };
 
 /**
@@ -279,11 +367,66 @@ class BTypeFactory {
   /**
    * @brief Builds B types from an XML document following RichTypesInfo schema
    * @param root The tinyxml2 XML element RichTypeInfos
+   * @param nbThreads Number of threads used to create the types. With a
+   * single thread, types are created in id order. With more threads, types
+   * are created level by level of the dependency graph between ids, the types
+   * of a level being created concurrently: the resulting types are the same,
+   * but their order in the table may differ. 0 means one thread per hardware
+   * thread.
+   * @return The types, indexed by RichType id
    * @throw BTypeFactory::Exception if the XML is invalid or parsing fails
    */
-  static void buildFromXML(const tinyxml2::XMLElement *root);
+  static std::vector<std::shared_ptr<BType>> buildFromXML(
+      const tinyxml2::XMLElement *root, unsigned nbThreads = 1);
+
+  /**
+   * @brief Builds B types from the text of an XML document following
+   * RichTypesInfo schema
+   * @param xml The text of the document
+   * @param nbThreads Number of threads used to create the types, as for
+   * buildFromXML
+   * @return The types, indexed by RichType id
+   * @throw BTypeFactory::Exception if the document is not well-formed or does
+   * not follow the schema
+   *
+   * @note The document is read by a dedicated scanner that builds no DOM and
+   * is much faster than tinyxml2 followed by buildFromXML.
+   */
+  static std::vector<std::shared_ptr<BType>> readXMLRichTypesInfo(
+      std::string_view xml, unsigned nbThreads = 1);
 
  private:
+  friend class BTypeStaging;
+  friend class BTypeAudit;
+  friend class BTypeSubscription;
+  friend class BTypeListener;
+
+  // Number of types in the table, read without taking a lock. A type is
+  // counted once it is in the table.
+  static size_t published();
+  // Appends the types with indices in [first, last) to types
+  static void copy(size_t first, size_t last,
+                   std::vector<std::shared_ptr<BType>> &types);
+  // Adds the types equal to staged types to the table in one batch, under a
+  // single lock, and delivers them once. The sub-types of a staged type must
+  // be in the table or before it in staged. Returns the types of the table,
+  // in the order of staged.
+  static std::vector<std::shared_ptr<BType>> publishStaged(
+      const std::vector<std::shared_ptr<BType>> &staged);
+
+  // Lookups that never create a type: they return nullptr if the type is not
+  // in the table.
+  static std::shared_ptr<BType> findBasic(BType::Kind kind);
+  static std::shared_ptr<BType> findProduct(const std::shared_ptr<BType> &lhs,
+                                            const std::shared_ptr<BType> &rhs);
+  static std::shared_ptr<BType> findPowerSet(
+      const std::shared_ptr<BType> &content);
+  static std::shared_ptr<BType> findAbstractSet(const std::string &name);
+  static std::shared_ptr<BType> findEnumeratedSet(const std::string &name);
+  static std::shared_ptr<BType> findStruct(
+      const std::vector<std::pair<std::string, std::shared_ptr<BType>>>
+          &fields);
+
   // Basic types (initialized in cpp file)
   static std::shared_ptr<BType> INTEGER;
   static std::shared_ptr<BType> BOOLEAN;
@@ -302,66 +445,80 @@ class BTypeFactory {
 
 class BType::ProductType : public BType {
  public:
-  void accept(Visitor &v) const override { v.visitProductType(*this); }
+  void accept(Visitor &v) const { v.visitProductType(*this); }
 
-  size_t hash_combine(size_t seed) const override;
   std::shared_ptr<BType> lhs;
   std::shared_ptr<BType> rhs;
+
+ private:
   ProductType(std::shared_ptr<BType> lhs, std::shared_ptr<BType> rhs)
-      : BType(Kind::ProductType), lhs{lhs}, rhs{rhs} {}
-  virtual ~ProductType() = default;
+      : BType(Kind::ProductType), lhs{lhs}, rhs{rhs} {
+    m_hash = structuralHash();
+  }
   friend class BTypeFactory;
   friend class BTypeCache;
+  template <typename>
+  friend struct BType::Allocator;
 };
 
 class BType::PowerType : public BType {
  public:
-  size_t hash_combine(size_t seed) const override;
-  void accept(Visitor &v) const override { v.visitPowerType(*this); }
+  void accept(Visitor &v) const { v.visitPowerType(*this); }
   const std::shared_ptr<BType> m_content;
+
+ private:
   PowerType(std::shared_ptr<BType> content)
-      : BType(BType::Kind::PowerType), m_content{content} {};
-  virtual ~PowerType() = default;
+      : BType(BType::Kind::PowerType), m_content{content} {
+    m_hash = structuralHash();
+  };
   friend class BTypeFactory;
   friend class BTypeCache;
+  template <typename>
+  friend struct BType::Allocator;
 };
 
 class BType::AbstractSet : public BType {
  public:
-  size_t hash_combine(size_t seed) const override;
-  void accept(Visitor &v) const override { v.visitAbstractSet(*this); }
+  void accept(Visitor &v) const { v.visitAbstractSet(*this); }
   const std::string &getName() const { return m_name; }
-  AbstractSet(const std::string &name)
-      : BType(BType::Kind::AbstractSet), m_name{name} {};
-  virtual ~AbstractSet() = default;
   const std::string m_name;
+
+ private:
+  AbstractSet(const std::string &name)
+      : BType(BType::Kind::AbstractSet), m_name{name} {
+    m_hash = structuralHash();
+  };
   friend class BTypeFactory;
   friend class BTypeCache;
+  template <typename>
+  friend struct BType::Allocator;
 };
 
 class BType::EnumeratedSet : public BType {
  public:
-  size_t hash_combine(size_t seed) const override;
-  void accept(Visitor &v) const override { v.visitEnumeratedSet(*this); }
+  void accept(Visitor &v) const { v.visitEnumeratedSet(*this); }
 
   const std::string &getName() const { return m_name; }
   const std::vector<std::string> &getValues() const { return m_values; }
   const std::string m_name;
   const std::vector<std::string> m_values;
+
+ private:
   EnumeratedSet(const std::pair<std::string, std::vector<std::string>> &values)
       : BType(BType::Kind::EnumeratedSet),
         m_name(values.first),
-        m_values{values.second} {}
-  virtual ~EnumeratedSet() = default;
+        m_values{values.second} {
+    m_hash = structuralHash();
+  }
   friend class BTypeFactory;
   friend class BTypeCache;
+  template <typename>
+  friend struct BType::Allocator;
 };
 
 class BType::StructType : public BType {
  public:
-  size_t hash_combine(size_t seed) const override;
-
-  void accept(Visitor &v) const override { v.visitStructType(*this); }
+  void accept(Visitor &v) const { v.visitStructType(*this); }
   //
   const std::vector<std::pair<std::string, std::shared_ptr<BType>>>
       m_fields;  // invariant: fields are sorted alphabetically
@@ -372,13 +529,39 @@ class BType::StructType : public BType {
       const {
     return m_fields;
   }
+
+ private:
   StructType(
       const std::vector<std::pair<std::string, std::shared_ptr<BType>>> &fields)
-      : BType(BType::Kind::Struct), m_fields{sort(fields)} {}
-  virtual ~StructType() = default;
+      : BType(BType::Kind::Struct), m_fields{sort(fields)} {
+    m_hash = structuralHash();
+  }
 
   friend class BTypeFactory;
   friend class BTypeCache;
+  template <typename>
+  friend struct BType::Allocator;
 };
 
+template <typename F>
+void BType::forEachChild(F &&f) const {
+  switch (m_kind) {
+    case Kind::ProductType: {
+      const auto &product = static_cast<const ProductType &>(*this);
+      f(product.lhs);
+      f(product.rhs);
+      break;
+    }
+    case Kind::PowerType:
+      f(static_cast<const PowerType &>(*this).m_content);
+      break;
+    case Kind::Struct:
+      for (const auto &field : static_cast<const StructType &>(*this).m_fields)
+        f(field.second);
+      break;
+    default:
+      break;
+  }
+}
+
 #endif
@@ -0,0 +1,400 @@
+/* @file btype_artifact_cache.cpp
+   @brief Implementation file for the BTypeArtifactCache class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_artifact_cache.h"
+
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#include "btype_index_memo.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BTYPE_ARTIFACT_CACHE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// File layout: a FileHeader, then records. A record is a RecordHeader, the
+// kind of the artifact and the artifact. Integers are in the byte order of
+// the machine, which is checked when the file is opened.
+struct FileHeader {
+  char magic[8];
+  uint32_t byteOrder;
+  uint32_t format;
+};
+
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t high;
+  uint64_t low;
+  uint64_t kindSize;
+  uint64_t artifactSize;
+  // Hash of the other fields, the kind and the artifact
+  uint64_t checksum;
+};
+
+constexpr char fileMagic[8] = {'B', 'T', 'Y', 'P', 'E', 'A', 'C', '\n'};
+constexpr uint32_t byteOrder = 0x01020304;
+constexpr uint32_t format = 1;
+constexpr uint32_t recordMagic = 0x52545942;  // "BYTR"
+
+uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// Two independent 64-bit hashes of a sequence of words and strings. Strings
+// are read as little-endian words, so that the result does not depend on the
+// machine.
+class Hasher {
+ public:
+  void word(uint64_t w) {
+    m_high = mix(m_high ^ w);
+    m_low = mix((m_low + w) * 0x9e3779b97f4a7c15ULL + 1);
+  }
+  void bytes(std::string_view s) {
+    word(s.size());
+    size_t i = 0;
+    for (; i + 8 <= s.size(); i += 8) word(load(s.data() + i, 8));
+    if (i < s.size()) word(load(s.data() + i, s.size() - i));
+  }
+  BTypeArtifactCache::Fingerprint result() const { return {m_high, m_low}; }
+
+ private:
+  static uint64_t load(const char *p, size_t n) {
+    uint64_t w = 0;
+    for (size_t k = 0; k < n; ++k)
+      w |= uint64_t(static_cast<unsigned char>(p[k])) << (8 * k);
+    return w;
+  }
+  uint64_t m_high = 0x6a09e667f3bcc908ULL;
+  uint64_t m_low = 0xbb67ae8584caa73bULL;
+};
+
+const char *kindName(BType::Kind kind) {
+  switch (kind) {
+    case BType::Kind::INTEGER:
+      return "INTEGER";
+    case BType::Kind::BOOLEAN:
+      return "BOOL";
+    case BType::Kind::FLOAT:
+      return "FLOAT";
+    case BType::Kind::REAL:
+      return "REAL";
+    case BType::Kind::STRING:
+      return "STRING";
+    case BType::Kind::ProductType:
+      return "Product";
+    case BType::Kind::PowerType:
+      return "PowerSet";
+    case BType::Kind::Struct:
+      return "Struct";
+    case BType::Kind::AbstractSet:
+      return "AbstractSet";
+    case BType::Kind::EnumeratedSet:
+      return "EnumeratedSet";
+  }
+  return "";
+}
+
+// Fingerprint of a type from the fingerprints of its sub-types
+template <typename F>
+BTypeArtifactCache::Fingerprint compute(const BType &type,
+                                        const F &childFingerprint) {
+  Hasher hasher;
+  hasher.bytes(kindName(type.getKind()));
+  switch (type.getKind()) {
+    case BType::Kind::AbstractSet:
+      hasher.bytes(static_cast<const BType::AbstractSet &>(type).getName());
+      break;
+    case BType::Kind::EnumeratedSet: {
+      const auto &set = static_cast<const BType::EnumeratedSet &>(type);
+      hasher.bytes(set.getName());
+      hasher.word(set.getValues().size());
+      for (const auto &value : set.getValues()) hasher.bytes(value);
+      break;
+    }
+    case BType::Kind::Struct:
+      hasher.word(
+          static_cast<const BType::StructType &>(type).getFields().size());
+      for (const auto &field :
+           static_cast<const BType::StructType &>(type).getFields())
+        hasher.bytes(field.first);
+      break;
+    default:
+      break;
+  }
+  type.forEachChild([&](const std::shared_ptr<BType> &child) {
+    const auto fingerprint = childFingerprint(*child);
+    hasher.word(fingerprint.high);
+    hasher.word(fingerprint.low);
+  });
+  return hasher.result();
+}
+
+uint64_t checksum(const RecordHeader &header, std::string_view kind,
+                  std::string_view artifact) {
+  Hasher hasher;
+  hasher.word(header.magic);
+  hasher.word(header.version);
+  hasher.word(header.high);
+  hasher.word(header.low);
+  hasher.bytes(kind);
+  hasher.bytes(artifact);
+  return hasher.result().high;
+}
+
+}  // namespace
+
+struct BTypeArtifactCache::Region {
+  // Byte at file offset first
+  const char *data = nullptr;
+  uint64_t first = 0;
+  uint64_t last = 0;
+  void *map = nullptr;
+  size_t mapSize = 0;
+  std::unique_ptr<char[]> buffer;
+
+  const char *at(uint64_t offset) const { return data + (offset - first); }
+  ~Region() {
+#ifdef BTYPE_ARTIFACT_CACHE_MMAP
+    if (map != nullptr) munmap(map, mapSize);
+#endif
+  }
+};
+
+BTypeArtifactCache::Fingerprint BTypeArtifactCache::fingerprint(
+    const BType &type) {
+  static BTypeIndexMemo<Fingerprint> memo;
+  return memo.getInIndexOrder(type, [](const BType &t) {
+    return compute(t, [](const BType &child) { return fingerprint(child); });
+  });
+}
+
+size_t BTypeArtifactCache::KeyHash::operator()(const Key &key) const {
+  return static_cast<size_t>(
+      mix(key.fingerprint.low ^ std::hash<std::string_view>{}(key.kind) ^
+          (uint64_t(key.version) << 32)));
+}
+
+BTypeArtifactCache::BTypeArtifactCache(const std::string &path)
+    : m_path{path} {
+  m_file = std::fopen(path.c_str(), "ab");
+  if (m_file == nullptr)
+    throw BTypeFactory::Exception("Cannot open artifact cache " + path);
+  // Unbuffered, so that a record is passed to the system in a single write
+  std::setvbuf(m_file, nullptr, _IONBF, 0);
+  // A new file gets a header. If several processes create the file at once,
+  // the extra headers are skipped as torn records.
+  std::fseek(m_file, 0, SEEK_END);
+  if (std::ftell(m_file) == 0) {
+    FileHeader header;
+    std::memcpy(header.magic, fileMagic, sizeof header.magic);
+    header.byteOrder = byteOrder;
+    header.format = format;
+    if (std::fwrite(&header, sizeof header, 1, m_file) != 1 ||
+        std::fflush(m_file) != 0) {
+      std::fclose(m_file);
+      throw BTypeFactory::Exception("Cannot write artifact cache " + path);
+    }
+  }
+  try {
+    readTail();
+    if (m_regions.empty())
+      throw BTypeFactory::Exception("Not an artifact cache: " + path);
+  } catch (...) {
+    std::fclose(m_file);
+    throw;
+  }
+}
+
+BTypeArtifactCache::~BTypeArtifactCache() { std::fclose(m_file); }
+
+// Maps or reads the part of the file after m_scanned and reads its records
+void BTypeArtifactCache::readTail() {
+  auto region = std::make_unique<Region>();
+#ifdef BTYPE_ARTIFACT_CACHE_MMAP
+  const int fd = open(m_path.c_str(), O_RDONLY);
+  struct stat status;
+  if (fd < 0 || fstat(fd, &status) != 0) {
+    if (fd >= 0) close(fd);
+    throw BTypeFactory::Exception("Cannot read artifact cache " + m_path);
+  }
+  const auto size = static_cast<uint64_t>(status.st_size);
+  if (size <= m_scanned) {
+    close(fd);
+    return;
+  }
+  const auto page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  region->first = m_scanned / page * page;
+  region->last = size;
+  region->mapSize = static_cast<size_t>(size - region->first);
+  region->map = mmap(nullptr, region->mapSize, PROT_READ, MAP_SHARED, fd,
+                     static_cast<off_t>(region->first));
+  close(fd);
+  if (region->map == MAP_FAILED) {
+    region->map = nullptr;
+    throw BTypeFactory::Exception("Cannot map artifact cache " + m_path);
+  }
+  region->data = static_cast<const char *>(region->map);
+#else
+  std::ifstream is(m_path, std::ios::binary | std::ios::ate);
+  if (!is)
+    throw BTypeFactory::Exception("Cannot read artifact cache " + m_path);
+  const auto size = static_cast<uint64_t>(is.tellg());
+  if (size <= m_scanned) return;
+  region->first = m_scanned;
+  region->last = size;
+  region->buffer.reset(new char[size - m_scanned]);
+  is.seekg(static_cast<std::streamoff>(m_scanned));
+  is.read(region->buffer.get(), static_cast<std::streamsize>(size - m_scanned));
+  if (!is)
+    throw BTypeFactory::Exception("Cannot read artifact cache " + m_path);
+  region->data = region->buffer.get();
+#endif
+  if (m_scanned == 0) {
+    FileHeader header;
+    if (size < sizeof header) return;
+    std::memcpy(&header, region->at(0), sizeof header);
+    if (std::memcmp(header.magic, fileMagic, sizeof header.magic) != 0 ||
+        header.byteOrder != byteOrder || header.format != format)
+      return;
+    m_scanned = sizeof header;
+  }
+  scan(*region);
+  m_regions.push_back(std::move(region));
+}
+
+// Reads the records from m_scanned. Bytes that do not start a valid record
+// are skipped. Reading stops before a record that extends past the end of the
+// region, since it may be being written, unless a valid record follows it: it
+// was then torn by a crash.
+void BTypeArtifactCache::scan(const Region &region) {
+  enum class Status { Valid, Truncated, Invalid };
+  RecordHeader header;
+  std::string_view kind;
+  std::string_view artifact;
+  auto read = [&](uint64_t offset) {
+    if (region.last - offset < sizeof header) return Status::Truncated;
+    std::memcpy(&header, region.at(offset), sizeof header);
+    if (header.magic != recordMagic) return Status::Invalid;
+    const uint64_t available = region.last - offset - sizeof header;
+    if (header.kindSize > available ||
+        header.artifactSize > available - header.kindSize)
+      return Status::Truncated;
+    kind = std::string_view(region.at(offset + sizeof header), header.kindSize);
+    artifact = std::string_view(kind.data() + kind.size(), header.artifactSize);
+    return header.checksum == checksum(header, kind, artifact)
+               ? Status::Valid
+               : Status::Invalid;
+  };
+
+  uint64_t offset = m_scanned;
+  for (;;) {
+    const Status status = read(offset);
+    if (status == Status::Invalid) {
+      ++offset;
+    } else if (status == Status::Truncated) {
+      uint64_t next = offset + 1;
+      while (next < region.last && read(next) != Status::Valid) ++next;
+      if (next >= region.last) break;
+      offset = next;
+    } else {
+      m_artifacts.insert_or_assign(
+          Key{{header.high, header.low}, kind, header.version}, artifact);
+      offset += sizeof header + kind.size() + artifact.size();
+    }
+  }
+  m_scanned = offset;
+}
+
+std::optional<std::string_view> BTypeArtifactCache::find(
+    const Fingerprint &fingerprint, std::string_view kind,
+    uint32_t version) const {
+  std::shared_lock lock(m_mutex);
+  auto it = m_artifacts.find(Key{fingerprint, kind, version});
+  if (it == m_artifacts.end()) return std::nullopt;
+  return it->second;
+}
+
+std::string_view BTypeArtifactCache::insert(const Fingerprint &fingerprint,
+                                            std::string_view kind,
+                                            uint32_t version,
+                                            std::string_view artifact) {
+  std::unique_lock lock(m_mutex);
+  return append(Key{fingerprint, kind, version}, artifact);
+}
+
+std::string_view BTypeArtifactCache::insertIfAbsent(
+    const Fingerprint &fingerprint, std::string_view kind, uint32_t version,
+    std::string_view artifact) {
+  std::unique_lock lock(m_mutex);
+  auto it = m_artifacts.find(Key{fingerprint, kind, version});
+  if (it != m_artifacts.end()) return it->second;
+  return append(Key{fingerprint, kind, version}, artifact);
+}
+
+// Writes a record with a single write, and keeps a copy of it in memory
+std::string_view BTypeArtifactCache::append(const Key &key,
+                                            std::string_view artifact) {
+  RecordHeader header;
+  header.magic = recordMagic;
+  header.version = key.version;
+  header.high = key.fingerprint.high;
+  header.low = key.fingerprint.low;
+  header.kindSize = key.kind.size();
+  header.artifactSize = artifact.size();
+  header.checksum = checksum(header, key.kind, artifact);
+  std::string record(sizeof header + key.kind.size() + artifact.size(), '\0');
+  std::memcpy(&record[0], &header, sizeof header);
+  std::memcpy(&record[sizeof header], key.kind.data(), key.kind.size());
+  std::memcpy(&record[sizeof header + key.kind.size()], artifact.data(),
+              artifact.size());
+  if (std::fwrite(record.data(), 1, record.size(), m_file) != record.size() ||
+      std::fflush(m_file) != 0)
+    throw BTypeFactory::Exception("Cannot write artifact cache " + m_path);
+
+  const std::string &stored = m_appended.emplace_back(std::move(record));
+  const std::string_view kindView(stored.data() + sizeof header,
+                                  key.kind.size());
+  const std::string_view result(kindView.data() + kindView.size(),
+                                artifact.size());
+  m_artifacts.insert_or_assign(Key{key.fingerprint, kindView, key.version},
+                               result);
+  return result;
+}
+
+void BTypeArtifactCache::refresh() {
+  std::unique_lock lock(m_mutex);
+  readTail();
+}
+
+size_t BTypeArtifactCache::size() const {
+  std::shared_lock lock(m_mutex);
+  return m_artifacts.size();
+}
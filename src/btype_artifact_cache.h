@@ -0,0 +1,176 @@
+/* @file btype_artifact_cache.h
+   @brief Header file for the BTypeArtifactCache class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_ARTIFACT_CACHE_H
+#define BTYPE_ARTIFACT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "btype.h"
+
+/**
+ * @brief On-disk store of artifacts derived from B types (SMT declarations,
+ * layouts, generated code...), persistent across processes.
+ *
+ * An artifact is a byte string, keyed by the fingerprint of a type, the kind
+ * of the artifact (a name chosen by its producer) and the version of its
+ * producer. The fingerprint only depends on the structure of the type, so
+ * that it is the same across processes and builds, unlike BType::hash() and
+ * BType::index().
+ *
+ * The file is append-only: storing an artifact appends a record, and the
+ * last record of a key wins. The file is mapped in memory when opened, and
+ * the artifacts are read in place. A record is written with a single write
+ * and checksummed, so that several processes may append to the same file,
+ * and a record torn by a crash is skipped.
+ *
+ * The cache may be used by several threads. The views it returns are valid
+ * as long as the cache.
+ *
+ * @code
+ * BTypeArtifactCache cache("types.cache");
+ * std::string_view sort = cache.getOrCompute(type, "smt-sort", 1,
+ *                                            [&] { return declare(type); });
+ * @endcode
+ */
+class BTypeArtifactCache {
+ public:
+  /** @brief Structural fingerprint of a type (128 bits). */
+  struct Fingerprint {
+    uint64_t high;
+    uint64_t low;
+    bool operator==(const Fingerprint &other) const {
+      return high == other.high && low == other.low;
+    }
+    bool operator!=(const Fingerprint &other) const {
+      return !(*this == other);
+    }
+  };
+
+  /**
+   * @brief Gets the fingerprint of a type. It covers the whole structure,
+   * including the values of enumerated sets. Fingerprints of the types of the
+   * table are computed once, in index order, and memoized.
+   */
+  static Fingerprint fingerprint(const BType &type);
+
+  /**
+   * @brief Opens a cache file, creating it if it does not exist.
+   * @param path the path of the file
+   * @throw BTypeFactory::Exception if the file cannot be created or read, or
+   * is not a cache file
+   */
+  explicit BTypeArtifactCache(const std::string &path);
+  BTypeArtifactCache(const BTypeArtifactCache &) = delete;
+  BTypeArtifactCache &operator=(const BTypeArtifactCache &) = delete;
+  ~BTypeArtifactCache();
+
+  /**
+   * @brief Gets an artifact.
+   * @return the artifact, or no value if it is not in the cache
+   */
+  std::optional<std::string_view> find(const Fingerprint &fingerprint,
+                                       std::string_view kind,
+                                       uint32_t version) const;
+  std::optional<std::string_view> find(const BType &type,
+                                       std::string_view kind,
+                                       uint32_t version) const {
+    return find(fingerprint(type), kind, version);
+  }
+
+  /**
+   * @brief Stores an artifact, replacing the previous one of the same key.
+   * @return the stored artifact
+   * @throw BTypeFactory::Exception if the record cannot be written
+   */
+  std::string_view insert(const Fingerprint &fingerprint,
+                          std::string_view kind, uint32_t version,
+                          std::string_view artifact);
+  std::string_view insert(const BType &type, std::string_view kind,
+                          uint32_t version, std::string_view artifact) {
+    return insert(fingerprint(type), kind, version, artifact);
+  }
+
+  /**
+   * @brief Gets an artifact, computing and storing it if it is not in the
+   * cache.
+   * @param compute a callable returning the artifact as a std::string; it is
+   * called without any lock held
+   */
+  template <typename F>
+  std::string_view getOrCompute(const BType &type, std::string_view kind,
+                                uint32_t version, F &&compute) {
+    const Fingerprint key = fingerprint(type);
+    if (auto artifact = find(key, kind, version)) return *artifact;
+    const std::string artifact = compute();
+    return insertIfAbsent(key, kind, version, artifact);
+  }
+
+  /** @brief Reads the records appended by other processes since the file
+   * was opened or last refreshed. */
+  void refresh();
+
+  /** @brief Gets the number of keys. */
+  size_t size() const;
+
+ private:
+  struct Key {
+    Fingerprint fingerprint;
+    std::string_view kind;
+    uint32_t version;
+    bool operator==(const Key &other) const {
+      return fingerprint == other.fingerprint && kind == other.kind &&
+             version == other.version;
+    }
+  };
+  struct KeyHash {
+    size_t operator()(const Key &key) const;
+  };
+  // A part of the file, mapped or read in memory
+  struct Region;
+
+  std::string_view insertIfAbsent(const Fingerprint &fingerprint,
+                                  std::string_view kind, uint32_t version,
+                                  std::string_view artifact);
+  std::string_view append(const Key &key, std::string_view artifact);
+  void scan(const Region &region);
+  void readTail();
+
+  const std::string m_path;
+  std::FILE *m_file = nullptr;
+  mutable std::shared_mutex m_mutex;
+  std::vector<std::unique_ptr<Region>> m_regions;
+  // Records appended by this process
+  std::deque<std::string> m_appended;
+  // Artifacts, pointing into m_regions and m_appended
+  std::unordered_map<Key, std::string_view, KeyHash> m_artifacts;
+  // Offset of the first record not read yet
+  uint64_t m_scanned = 0;
+};
+
+#endif  // BTYPE_ARTIFACT_CACHE_H
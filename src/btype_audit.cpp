@@ -0,0 +1,139 @@
+/* @file btype_audit.cpp
+   @brief Implementation file for the BTypeAudit class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_audit.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "btype_parallel.h"
+
+namespace {
+
+// Number of positions checked by a task
+constexpr size_t chunkSize = 4096;
+
+}  // namespace
+
+BTypeAudit::BTypeAudit(unsigned nbThreads) : m_nbThreads{nbThreads} {
+  // One lock for the whole snapshot, rather than one per type
+  BTypeFactory::copy(0, BTypeFactory::size(), m_types);
+}
+
+BTypeAudit::BTypeAudit(std::vector<std::shared_ptr<BType>> types,
+                       unsigned nbThreads)
+    : m_nbThreads{nbThreads}, m_types{std::move(types)} {}
+
+std::vector<BTypeAudit::Violation> BTypeAudit::run(size_t first,
+                                                   size_t last) const {
+  last = std::min(last, m_types.size());
+  if (first >= last) return {};
+  const size_t nbChunks = (last - first + chunkSize - 1) / chunkSize;
+  std::vector<std::vector<size_t>> levels(1);
+  levels[0].reserve(nbChunks);
+  for (size_t chunk = 0; chunk < nbChunks; ++chunk)
+    levels[0].push_back(chunk);
+
+  // Each chunk has its own list, so that the result is ordered without
+  // sorting.
+  std::vector<std::vector<Violation>> found(nbChunks);
+  btypeParallel::runLevels(levels, m_nbThreads, [&](size_t chunk) {
+    const size_t begin = first + chunk * chunkSize;
+    const size_t end = std::min(last, begin + chunkSize);
+    for (size_t index = begin; index < end; ++index)
+      check(index, found[chunk]);
+  });
+
+  std::vector<Violation> violations;
+  for (auto &chunk : found) {
+    std::move(chunk.begin(), chunk.end(), std::back_inserter(violations));
+  }
+  return violations;
+}
+
+void BTypeAudit::check(size_t index,
+                       std::vector<Violation> &violations) const {
+  const BType &type = *m_types[index];
+  auto report = [&](Check check, std::string message) {
+    violations.push_back(Violation{index, check, std::move(message)});
+  };
+
+  if (type.index() != index) {
+    report(Check::Index, "Type at position " + std::to_string(index) +
+                             " has index " + std::to_string(type.index()));
+  }
+
+  type.forEachChild([&](const std::shared_ptr<BType> &child) {
+    const size_t position = child->index();
+    if (position >= index || m_types[position] != child) {
+      report(Check::ChildOrder, "Sub-type with index " +
+                                    std::to_string(position) +
+                                    " is not before its parent");
+    }
+  });
+
+  std::shared_ptr<BType> canonical;
+  switch (type.getKind()) {
+    case BType::Kind::INTEGER:
+    case BType::Kind::BOOLEAN:
+    case BType::Kind::FLOAT:
+    case BType::Kind::REAL:
+    case BType::Kind::STRING:
+      canonical = BTypeFactory::findBasic(type.getKind());
+      break;
+    case BType::Kind::ProductType: {
+      const auto &product = static_cast<const BType::ProductType &>(type);
+      canonical = BTypeFactory::findProduct(product.lhs, product.rhs);
+      break;
+    }
+    case BType::Kind::PowerType:
+      canonical = BTypeFactory::findPowerSet(
+          static_cast<const BType::PowerType &>(type).m_content);
+      break;
+    case BType::Kind::AbstractSet:
+      canonical = BTypeFactory::findAbstractSet(
+          static_cast<const BType::AbstractSet &>(type).getName());
+      break;
+    case BType::Kind::EnumeratedSet:
+      canonical = BTypeFactory::findEnumeratedSet(
+          static_cast<const BType::EnumeratedSet &>(type).getName());
+      break;
+    case BType::Kind::Struct: {
+      const auto &fields =
+          static_cast<const BType::StructType &>(type).getFields();
+      for (size_t i = 1; i < fields.size(); ++i) {
+        if (!(fields[i - 1].first < fields[i].first)) {
+          report(Check::FieldOrder, "Field " + fields[i].first +
+                                        " is not after field " +
+                                        fields[i - 1].first);
+        }
+      }
+      canonical = BTypeFactory::findStruct(fields);
+      break;
+    }
+  }
+  if (canonical.get() != &type) {
+    report(Check::Duplicate,
+           canonical ? "Same structure as the type with index " +
+                           std::to_string(canonical->index())
+                     : std::string("Structure not registered in the factory"));
+  }
+
+  if (type.m_hash != type.structuralHash())
+    report(Check::Hash, "Hash does not match the structure");
+}
@@ -0,0 +1,105 @@
+/* @file btype_audit.h
+   @brief Header file for the BTypeAudit class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_AUDIT_H
+#define BTYPE_AUDIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "btype.h"
+
+/**
+ * @brief Checks the invariants of the BTypeFactory table, in parallel.
+ *
+ * The audit works on a snapshot of the table taken at construction. For each
+ * type t at position i of the snapshot, it checks that:
+ * - t->index() is i (Check::Index);
+ * - the sub-types of t are at smaller positions of the snapshot
+ *   (Check::ChildOrder);
+ * - the fields of a struct are sorted, without duplicate names
+ *   (Check::FieldOrder);
+ * - t is the type returned by the factory for its structure, so that no
+ *   other type has the same structure (Check::Duplicate);
+ * - the hash of t matches its structure and the hashes of its sub-types
+ *   (Check::Hash).
+ *
+ * The checks only read the types, and the factory lookups take shared locks
+ * and never create types, so that they neither stall creators nor run
+ * listener callbacks: the audit may run while other threads create types.
+ *
+ * @code
+ * BTypeAudit audit;
+ * for (const auto &violation : audit.run())
+ *   log(violation.index, violation.message);
+ * @endcode
+ */
+class BTypeAudit {
+ public:
+  /** @brief The invariants. */
+  enum class Check { Index, ChildOrder, FieldOrder, Duplicate, Hash };
+
+  /** @brief A broken invariant. */
+  struct Violation {
+    /** @brief Position of the type in the snapshot. */
+    size_t index;
+    Check check;
+    std::string message;
+  };
+
+  /**
+   * @brief Takes a snapshot of the type table.
+   * @param nbThreads number of threads used by run(); 0 means one per
+   * hardware thread
+   */
+  explicit BTypeAudit(unsigned nbThreads = 0);
+
+  /**
+   * @brief Audits a given sequence of types, as if it were the table.
+   * @param types the types; none may be nullptr
+   * @param nbThreads number of threads used by run(); 0 means one per
+   * hardware thread
+   */
+  BTypeAudit(std::vector<std::shared_ptr<BType>> types, unsigned nbThreads);
+
+  /** @brief Gets the number of types in the snapshot. */
+  size_t size() const { return m_types.size(); }
+
+  /**
+   * @brief Checks the types of a range of positions of the snapshot.
+   *
+   * The range is divided in chunks that are checked concurrently. A range
+   * may be audited alone, e.g. the types created since the previous audit.
+   *
+   * @param first the first position
+   * @param last the position after the last one; clamped to size()
+   * @return the violations, by increasing position
+   */
+  std::vector<Violation> run(size_t first = 0, size_t last = SIZE_MAX) const;
+
+ private:
+  void check(size_t index, std::vector<Violation> &violations) const;
+
+  unsigned m_nbThreads;
+  std::vector<std::shared_ptr<BType>> m_types;
+};
+
+#endif  // BTYPE_AUDIT_H
@@ -17,65 +17,118 @@
    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <mutex>
 #include <shared_mutex>
 #include <unordered_map>
 
 #include "btype.h"
+#include "btype_hash_cons.h"
+#include "btype_subscription.h"
 
-// Hash functions for complex types
-struct ProductTypeHash {
-  size_t operator()(const std::pair<std::shared_ptr<BType>,
-                                    std::shared_ptr<BType>>& p) const {
-    return p.first->hash_combine(p.second->hash_combine(0));
+// Hash functions for the keys of complex types. Sub-types are maximally
+// shared, so they are identified by address: hashing a key does not traverse
+// the sub-types.
+struct PointerHash {
+  size_t operator()(const BType* type) const {
+    uint64_t h = reinterpret_cast<uintptr_t>(type);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
   }
 };
 
-struct PowerTypeHash {
-  size_t operator()(const std::shared_ptr<BType>& type) const {
-    return type->hash_combine(0);
+struct PointerPairHash {
+  size_t operator()(const std::pair<const BType*, const BType*>& p) const {
+    const size_t h = PointerHash{}(p.first);
+    return h ^ (PointerHash{}(p.second) + 0x9e3779b9 + (h << 6) + (h >> 2));
   }
 };
 
+// Set when the thread adds a type to the table, so that only the factory
+// functions that create types deliver them to the listeners
+static thread_local bool createdTypes = false;
+
 // Thread-safe type caches
 class BTypeCache {
  private:
-  mutable std::shared_mutex m_basic;
-  mutable std::shared_mutex m_mutexProduct;
-  mutable std::shared_mutex m_mutexPower;
-  mutable std::shared_mutex m_mutexAbstract;
-  mutable std::shared_mutex m_mutexEnumerated;
-  mutable std::shared_mutex m_mutexStruct;
+  using Table = HashConsTable<std::string, BType>;
+
   mutable std::shared_mutex m_mutexIndex;
-  std::unordered_map<std::pair<std::shared_ptr<BType>, std::shared_ptr<BType>>,
-                     std::shared_ptr<BType::ProductType>, ProductTypeHash>
-      m_productTypes;
-  std::unordered_map<std::shared_ptr<BType>, std::shared_ptr<BType::PowerType>,
-                     PowerTypeHash>
-      m_powerTypes;
-  std::unordered_map<std::string, std::shared_ptr<BType::AbstractSet>>
-      m_abstractSets;
-  std::unordered_map<std::string,
-                     std::shared_ptr<BType::EnumeratedSet>>
-      m_enumeratedSets;  // indexed by name
-  std::unordered_map<std::string,
-                     std::shared_ptr<BType::StructType>>
-      m_structTypes;  // indexed by space-ended field names
-  std::shared_ptr<BType> m_INTEGER;
-  std::shared_ptr<BType> m_BOOLEAN;
-  std::shared_ptr<BType> m_FLOAT;
-  std::shared_ptr<BType> m_REAL;
-  std::shared_ptr<BType> m_STRING;
   std::vector<std::shared_ptr<BType>> m_index;
+  // Releases the types from the last to the first once the tables, declared
+  // after it, are destroyed: a type is thus released after the types that
+  // contain it, so that releasing a long chain of types does not recurse
+  // once per link.
+  struct IndexRelease {
+    std::vector<std::shared_ptr<BType>>& index;
+    ~IndexRelease() {
+      while (!index.empty()) index.pop_back();
+    }
+  } m_indexRelease{m_index};
+  std::atomic<size_t> m_published{0};
+  // Each table indexes its new types with its exclusive lock held, so that a
+  // type is never visible to other threads before it is indexed: children are
+  // thus always indexed before their parents.
+  const std::function<void(const std::shared_ptr<BType>&)> m_onCreate =
+      [this](const std::shared_ptr<BType>& type) { index(type); };
+  HashConsTable<BType::Kind, BType> m_basic{m_onCreate};
+  HashConsTable<std::pair<const BType*, const BType*>, BType, PointerPairHash>
+      m_productTypes{m_onCreate};
+  HashConsTable<const BType*, BType, PointerHash> m_powerTypes{m_onCreate};
+  Table m_abstractSets{m_onCreate};
+  Table m_enumeratedSets{m_onCreate};  // indexed by name
+  Table m_structTypes{m_onCreate};     // indexed by structKey()
 
-  void index(std::shared_ptr<BType> type) {
+  // Key of a struct type: each field contributes its name and the index of
+  // its type, both terminated by ';'.
+  static std::string structKey(
+      const std::vector<std::pair<std::string, std::shared_ptr<BType>>>&
+          sortedFields) {
+    std::string keyString;
+    for (const auto& field : sortedFields) {
+      keyString.append(field.first);
+      keyString.push_back(';');
+      keyString.append(std::to_string(field.second->index()));
+      keyString.push_back(';');
+    }
+    return keyString;
+  }
+
+  void index(const std::shared_ptr<BType>& type) {
     std::unique_lock<std::shared_mutex> writeLock(m_mutexIndex);
-    type->m_index = m_index.size();
+    checkCapacity();
+    indexLocked(type);
+  }
+  void checkCapacity() const {
+    if (m_index.size() >= BType::noIndex)
+      throw BTypeFactory::Exception("Type table full");
+  }
+  // Adds a type to the table, with the index lock held
+  void indexLocked(const std::shared_ptr<BType>& type) {
+    type->m_index = static_cast<uint32_t>(m_index.size());
     m_index.push_back(type);
+    m_published.store(m_index.size(), std::memory_order_release);
+    createdTypes = true;
+  }
+
+  // Sub-types of new types must be in the table: a staged type must be
+  // committed first.
+  static void checkIndexed(const std::shared_ptr<BType>& type) {
+    if (type->index() == SIZE_MAX)
+      throw BTypeFactory::Exception("Sub-type not in the type table");
+  }
+
+  std::shared_ptr<BType> getBasic(BType::Kind kind) {
+    return m_basic.intern(kind,
+                          [kind] { return BType::make<BType>(kind); });
   }
 
  public:
-  BTypeCache() : m_INTEGER(), m_BOOLEAN(), m_FLOAT(), m_REAL(), m_STRING() {}
+  BTypeCache() = default;
   size_t size() const {
     std::shared_lock<std::shared_mutex> readLock(m_mutexIndex);
     return m_index.size();
@@ -84,244 +137,251 @@ class BTypeCache {
     std::shared_lock<std::shared_mutex> readLock(m_mutexIndex);
     return m_index[index];
   }
-  std::shared_ptr<BType> getInteger() {
-    {
-      std::shared_lock<std::shared_mutex> readLock(m_basic);
-      if (m_INTEGER) {
-        return m_INTEGER;
-      }
-    }
-    {
-      std::unique_lock<std::shared_mutex> writeLock(m_basic);
-      if (m_INTEGER) {
-        return m_INTEGER;
-      }
-      m_INTEGER = std::make_shared<BType>(BType::Kind::INTEGER);
-    }
-    index(m_INTEGER);
-    return m_INTEGER;
+  size_t published() const {
+    return m_published.load(std::memory_order_acquire);
   }
-  std::shared_ptr<BType> getBoolean() {
-    {
-      std::shared_lock<std::shared_mutex> readLock(m_basic);
-      if (m_BOOLEAN) {
-        return m_BOOLEAN;
-      }
-    }
-    {
-      std::unique_lock<std::shared_mutex> writeLock(m_basic);
-      if (m_BOOLEAN) {
-        return m_BOOLEAN;
-      }
-      m_BOOLEAN = std::make_shared<BType>(BType::Kind::BOOLEAN);
-    }
-    index(m_BOOLEAN);
-    return m_BOOLEAN;
+  void copy(size_t first, size_t last,
+            std::vector<std::shared_ptr<BType>>& types) const {
+    std::shared_lock<std::shared_mutex> readLock(m_mutexIndex);
+    types.insert(types.end(), m_index.begin() + first, m_index.begin() + last);
   }
-  std::shared_ptr<BType> getFloat() {
-    {
-      std::shared_lock<std::shared_mutex> readLock(m_basic);
-      if (m_FLOAT) {
-        return m_FLOAT;
-      }
-    }
-    {
-      std::unique_lock<std::shared_mutex> writeLock(m_basic);
-      if (m_FLOAT) {
-        return m_FLOAT;
-      }
-      m_FLOAT = std::make_shared<BType>(BType::Kind::FLOAT);
-    }
-    index(m_FLOAT);
-    return m_FLOAT;
+  std::shared_ptr<BType> getInteger() { return getBasic(BType::Kind::INTEGER); }
+  std::shared_ptr<BType> getBoolean() { return getBasic(BType::Kind::BOOLEAN); }
+  std::shared_ptr<BType> getFloat() { return getBasic(BType::Kind::FLOAT); }
+  std::shared_ptr<BType> getReal() { return getBasic(BType::Kind::REAL); }
+  std::shared_ptr<BType> getString() { return getBasic(BType::Kind::STRING); }
+  std::shared_ptr<BType> findBasic(BType::Kind kind) {
+    return m_basic.find(kind);
   }
-  std::shared_ptr<BType> getReal() {
-    {
-      std::shared_lock<std::shared_mutex> readLock(m_basic);
-      if (m_REAL) {
-        return m_REAL;
-      }
-    }
-    {
-      std::unique_lock<std::shared_mutex> writeLock(m_basic);
-      if (m_REAL) {
-        return m_REAL;
-      }
-      m_REAL = std::make_shared<BType>(BType::Kind::REAL);
-    }
-    index(m_REAL);
-    return m_REAL;
+  std::shared_ptr<BType> findProductType(const std::shared_ptr<BType>& lhs,
+                                         const std::shared_ptr<BType>& rhs) {
+    return m_productTypes.find(std::make_pair(lhs.get(), rhs.get()));
   }
-  std::shared_ptr<BType> getString() {
-    {
-      std::shared_lock<std::shared_mutex> readLock(m_basic);
-      if (m_STRING) {
-        return m_STRING;
-      }
-    }
-    {
-      std::unique_lock<std::shared_mutex> writeLock(m_basic);
-      if (m_STRING) {
-        return m_STRING;
-      }
-      m_STRING = std::make_shared<BType>(BType::Kind::STRING);
-    }
-    index(m_STRING);
-    return m_STRING;
+  std::shared_ptr<BType> findPowerType(const std::shared_ptr<BType>& content) {
+    return m_powerTypes.find(content.get());
+  }
+  std::shared_ptr<BType> findAbstractSet(const std::string& name) {
+    return m_abstractSets.find(name);
+  }
+  std::shared_ptr<BType> findEnumeratedSet(const std::string& name) {
+    return m_enumeratedSets.find(name);
+  }
+  std::shared_ptr<BType> findStruct(
+      const std::vector<std::pair<std::string, std::shared_ptr<BType>>>&
+          fields) {
+    return m_structTypes.find(structKey(BType::StructType::sort(fields)));
   }
   std::shared_ptr<BType> getOrCreateProductType(std::shared_ptr<BType> lhs,
                                                 std::shared_ptr<BType> rhs) {
-    auto key = std::make_pair(lhs, rhs);
-    {
-      std::shared_lock<std::shared_mutex> readLock(m_mutexProduct);
-      auto it = m_productTypes.find(key);
-      if (it != m_productTypes.end()) {
-        return it->second;
-      }
-    }
-    std::shared_ptr<BType::ProductType> newType;
-    {
-      std::unique_lock<std::shared_mutex> writeLock(m_mutexProduct);
-      auto it = m_productTypes.find(key);
-      if (it != m_productTypes.end()) {
-        return it->second;
-      }
-      newType = std::make_shared<BType::ProductType>(lhs, rhs);
-      m_productTypes[key] = newType;
-    }
-    index(newType);
-    return newType;
+    checkIndexed(lhs);
+    checkIndexed(rhs);
+    return m_productTypes.intern(std::make_pair(lhs.get(), rhs.get()), [&] {
+      return BType::make<BType::ProductType>(lhs, rhs);
+    });
   }
   std::shared_ptr<BType> getOrCreatePowerType(std::shared_ptr<BType> content) {
-    {
-      std::shared_lock<std::shared_mutex> readLock(m_mutexPower);
-      auto it = m_powerTypes.find(content);
-      if (it != m_powerTypes.end()) {
-        return it->second;
-      }
-    }
-    std::shared_ptr<BType::PowerType> newType;
-    {
-      std::unique_lock<std::shared_mutex> writeLock(m_mutexPower);
-      auto it = m_powerTypes.find(content);
-      if (it != m_powerTypes.end()) {
-        return it->second;
-      }
-      newType = std::make_shared<BType::PowerType>(content);
-      m_powerTypes[content] = newType;
-    }
-    index(newType);
-    return newType;
+    checkIndexed(content);
+    return m_powerTypes.intern(content.get(), [&] {
+      return BType::make<BType::PowerType>(content);
+    });
   }
   std::shared_ptr<BType> getOrCreateAbstractSet(const std::string& name) {
-    {
-      std::shared_lock<std::shared_mutex> readLock(m_mutexAbstract);
-      auto it = m_abstractSets.find(name);
-      if (it != m_abstractSets.end()) {
-        return it->second;
-      }
-    }
-    std::shared_ptr<BType::AbstractSet> newType;
-    {
-      std::unique_lock<std::shared_mutex> writeLock(m_mutexAbstract);
-      auto it = m_abstractSets.find(name);
-      if (it != m_abstractSets.end()) {
-        return it->second;
-      }
-      newType = std::make_shared<BType::AbstractSet>(name);
-      m_abstractSets[name] = newType;
-    }
-    index(newType);
-    return newType;
+    return m_abstractSets.intern(
+        name, [&] { return BType::make<BType::AbstractSet>(name); });
   }
   std::shared_ptr<BType> getOrCreateEnumeratedSet(
       const std::string& name, const std::vector<std::string>& values) {
-    {
-      std::shared_lock<std::shared_mutex> readLock(m_mutexEnumerated);
-      auto it = m_enumeratedSets.find(name);
-      if (it != m_enumeratedSets.end()) {
-        return it->second;
-      }
-    }
-    std::shared_ptr<BType::EnumeratedSet> newType;
-    {
-      std::unique_lock<std::shared_mutex> writeLock(m_mutexEnumerated);
-      auto it = m_enumeratedSets.find(name);
-      if (it != m_enumeratedSets.end()) {
-        return it->second;
-      }
-      newType = std::make_shared<BType::EnumeratedSet>(std::pair(name, values));
-      m_enumeratedSets[name] = newType;
-    }
-    index(newType);
-    return newType;
+    return m_enumeratedSets.intern(name, [&] {
+      return BType::make<BType::EnumeratedSet>(std::pair(name, values));
+    });
   }
   std::shared_ptr<BType> getOrCreateStruct(
       const std::vector<std::pair<std::string, std::shared_ptr<BType>>>&
           fields) {
+    for (const auto& field : fields) checkIndexed(field.second);
     auto sortedFields = BType::StructType::sort(fields);
-    std::string keyString;
-    for (const auto& field : sortedFields) {
-      keyString.append(field.first);
-      keyString.push_back(';');
-    }
-    {
-      std::shared_lock<std::shared_mutex> readLock(m_mutexStruct);
-      auto it = m_structTypes.find(keyString);
-      if (it != m_structTypes.end()) {
-        return it->second;
-      }
-    }
-    std::shared_ptr<BType::StructType> newType;
-    {
-      std::unique_lock<std::shared_mutex> writeLock(m_mutexStruct);
-      auto it = m_structTypes.find(keyString);
-      if (it != m_structTypes.end()) {
-        return it->second;
+    return m_structTypes.intern(structKey(sortedFields), [&] {
+      return BType::make<BType::StructType>(sortedFields);
+    });
+  }
+
+  // Adds the types equal to staged types to the table, holding the locks of
+  // the tables and of the index for the whole batch. The sub-types of a
+  // staged type are in the table or before it in staged.
+  std::vector<std::shared_ptr<BType>> publishStaged(
+      const std::vector<std::shared_ptr<BType>>& staged) {
+    std::unordered_map<const BType*, std::shared_ptr<BType>> published;
+    auto resolve = [&](const std::shared_ptr<BType>& type) {
+      if (type->index() != SIZE_MAX) return type;
+      auto it = published.find(type.get());
+      if (it == published.end())
+        throw BTypeFactory::Exception("Sub-type not in the type table");
+      return it->second;
+    };
+    decltype(m_productTypes)::Batch products(m_productTypes);
+    decltype(m_powerTypes)::Batch powers(m_powerTypes);
+    Table::Batch abstractSets(m_abstractSets);
+    Table::Batch enumeratedSets(m_enumeratedSets);
+    Table::Batch structs(m_structTypes);
+    std::unique_lock<std::shared_mutex> writeLock(m_mutexIndex);
+    std::vector<std::shared_ptr<BType>> result;
+    result.reserve(staged.size());
+    for (const auto& type : staged) {
+      checkCapacity();
+      std::pair<std::shared_ptr<BType>, bool> entry;
+      switch (type->getKind()) {
+        case BType::Kind::ProductType: {
+          const auto& product = *type->asProductType();
+          auto lhs = resolve(product.lhs);
+          auto rhs = resolve(product.rhs);
+          entry = products.intern(std::make_pair(lhs.get(), rhs.get()), [&] {
+            return BType::make<BType::ProductType>(lhs, rhs);
+          });
+          break;
+        }
+        case BType::Kind::PowerType: {
+          auto content = resolve(type->asPowerType()->m_content);
+          entry = powers.intern(content.get(), [&] {
+            return BType::make<BType::PowerType>(content);
+          });
+          break;
+        }
+        case BType::Kind::AbstractSet: {
+          const auto& name = type->asAbstractSetType()->getName();
+          entry = abstractSets.intern(
+              name, [&] { return BType::make<BType::AbstractSet>(name); });
+          break;
+        }
+        case BType::Kind::EnumeratedSet: {
+          const auto& set = *type->asEnumeratedSetType();
+          entry = enumeratedSets.intern(set.getName(), [&] {
+            return BType::make<BType::EnumeratedSet>(
+                std::pair(set.getName(), set.getValues()));
+          });
+          break;
+        }
+        case BType::Kind::Struct: {
+          auto fields = type->asStructType()->getFields();
+          for (auto& field : fields) field.second = resolve(field.second);
+          entry = structs.intern(structKey(fields), [&] {
+            return BType::make<BType::StructType>(fields);
+          });
+          break;
+        }
+        default:
+          // Basic types are never staged
+          entry = {type, false};
+          break;
       }
-      newType = std::make_shared<BType::StructType>(sortedFields);
-      m_structTypes[keyString] = newType;
+      if (entry.second) indexLocked(entry.first);
+      published.emplace(type.get(), entry.first);
+      result.push_back(entry.first);
     }
-    index(newType);
-    return newType;
+    return result;
   }
 };
 
 std::unique_ptr<BTypeCache> cache = std::make_unique<BTypeCache>();
 
+// Delivers the types created by a factory method to the listeners, once the
+// tables are unlocked. Lookups of existing types deliver nothing.
+static void deliverCreated() {
+  if (createdTypes) {
+    createdTypes = false;
+    BTypeListener::deliver();
+  }
+}
+
+static std::shared_ptr<BType> publish(std::shared_ptr<BType> type) {
+  deliverCreated();
+  return type;
+}
+
 // Factory methods implementation
 
-std::shared_ptr<BType> BTypeFactory::Integer() { return cache->getInteger(); }
-std::shared_ptr<BType> BTypeFactory::Boolean() { return cache->getBoolean(); }
-std::shared_ptr<BType> BTypeFactory::Float() { return cache->getFloat(); }
-std::shared_ptr<BType> BTypeFactory::Real() { return cache->getReal(); }
-std::shared_ptr<BType> BTypeFactory::String() { return cache->getString(); }
+std::shared_ptr<BType> BTypeFactory::Integer() {
+  return publish(cache->getInteger());
+}
+std::shared_ptr<BType> BTypeFactory::Boolean() {
+  return publish(cache->getBoolean());
+}
+std::shared_ptr<BType> BTypeFactory::Float() {
+  return publish(cache->getFloat());
+}
+std::shared_ptr<BType> BTypeFactory::Real() {
+  return publish(cache->getReal());
+}
+std::shared_ptr<BType> BTypeFactory::String() {
+  return publish(cache->getString());
+}
 
 std::shared_ptr<BType> BTypeFactory::Product(std::shared_ptr<BType> lhs,
                                              std::shared_ptr<BType> rhs) {
-  return cache->getOrCreateProductType(lhs, rhs);
+  return publish(cache->getOrCreateProductType(lhs, rhs));
 }
 
 std::shared_ptr<BType> BTypeFactory::PowerSet(std::shared_ptr<BType> content) {
-  return cache->getOrCreatePowerType(content);
+  return publish(cache->getOrCreatePowerType(content));
 }
 
 std::shared_ptr<BType> BTypeFactory::AbstractSet(const std::string& name) {
-  return cache->getOrCreateAbstractSet(name);
+  return publish(cache->getOrCreateAbstractSet(name));
 }
 
 std::shared_ptr<BType> BTypeFactory::EnumeratedSet(
     const std::string& name, const std::vector<std::string>& values) {
-  return cache->getOrCreateEnumeratedSet(name, values);
+  return publish(cache->getOrCreateEnumeratedSet(name, values));
 }
 
 std::shared_ptr<BType> BTypeFactory::Struct(
     const std::vector<std::pair<std::string, std::shared_ptr<BType>>>& fields) {
-  return cache->getOrCreateStruct(fields);
+  return publish(cache->getOrCreateStruct(fields));
+}
+
+std::vector<std::shared_ptr<BType>> BTypeFactory::publishStaged(
+    const std::vector<std::shared_ptr<BType>>& staged) {
+  std::vector<std::shared_ptr<BType>> result = cache->publishStaged(staged);
+  deliverCreated();
+  return result;
 }
 
 size_t BTypeFactory::size() { return cache->size(); }
 
+size_t BTypeFactory::published() { return cache->published(); }
+
+void BTypeFactory::copy(size_t first, size_t last,
+                        std::vector<std::shared_ptr<BType>>& types) {
+  cache->copy(first, last, types);
+}
+
 std::shared_ptr<BType> BTypeFactory::at(size_t index) {
   return cache->at(index);
-}
\ No newline at end of file
+}
+
+std::shared_ptr<BType> BTypeFactory::findBasic(BType::Kind kind) {
+  return cache->findBasic(kind);
+}
+
+std::shared_ptr<BType> BTypeFactory::findProduct(
+    const std::shared_ptr<BType>& lhs, const std::shared_ptr<BType>& rhs) {
+  return cache->findProductType(lhs, rhs);
+}
+
+std::shared_ptr<BType> BTypeFactory::findPowerSet(
+    const std::shared_ptr<BType>& content) {
+  return cache->findPowerType(content);
+}
+
+std::shared_ptr<BType> BTypeFactory::findAbstractSet(const std::string& name) {
+  return cache->findAbstractSet(name);
+}
+
+std::shared_ptr<BType> BTypeFactory::findEnumeratedSet(
+    const std::string& name) {
+  return cache->findEnumeratedSet(name);
+}
+
+std::shared_ptr<BType> BTypeFactory::findStruct(
+    const std::vector<std::pair<std::string, std::shared_ptr<BType>>>& fields) {
+  return cache->findStruct(fields);
+}
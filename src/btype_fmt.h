@@ -19,6 +19,11 @@
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
 #include "btype.h"
 
 // Forward declare formatter specializations
@@ -176,4 +181,182 @@ struct fmt::formatter<BType::StructType> {
   }
 };
 
+/**
+ * @brief Selects the sharing-preserving format of a type.
+ *
+ * The default formatter prints a type as a tree, so that a sub-type occurring
+ * k times is printed k times. With this wrapper, each sub-type that occurs
+ * more than once and whose tree has at least `threshold` nodes is printed
+ * once, as a let-binding named after its index in the type table:
+ * @code
+ * fmt::format("{}", BTypeSharedFormat{type})
+ * // let t3 = (INTEGER × BOOLEAN) in ℙ((t3 × t3))
+ * @endcode
+ * The output size is linear in the number of distinct sub-types. Types of
+ * any depth can be printed: the printer does not recurse down the type.
+ */
+struct BTypeSharedFormat {
+  std::shared_ptr<BType> type;
+  size_t threshold = 3;
+};
+
+namespace btypeFmt {
+
+/** @brief Implementation of the BTypeSharedFormat formatter. */
+class SharingPrinter {
+ public:
+  explicit SharingPrinter(size_t threshold) : m_threshold{threshold} {}
+
+  std::string print(const BType& root) {
+    analyze(root);
+    std::string result;
+    for (const BType* type : m_postOrder) {
+      Info& info = m_info[type];
+      if (type == &root || info.refs < 2 || info.size < m_threshold) continue;
+      info.name = type->index() != SIZE_MAX
+                      ? fmt::format("t{}", type->index())
+                      : fmt::format("u{}", m_unindexed++);
+      result += fmt::format("let {} = ", info.name);
+      body(*type, result);
+      result += " in ";
+    }
+    body(root, result);
+    return result;
+  }
+
+ private:
+  struct Info {
+    size_t refs = 0;
+    size_t size = 1;  // tree size, saturated at SIZE_MAX
+    std::string name;
+  };
+
+  // Counts references and tree sizes, visiting each distinct sub-type once.
+  // The traversal keeps its own stack, so that the depth of a type is not
+  // limited by the size of the thread stack.
+  void analyze(const BType& root) {
+    struct Frame {
+      const BType* type;
+      std::vector<const BType*> children;
+      size_t next = 0;
+    };
+    std::vector<Frame> stack;
+    auto enter = [&](const BType& type) {
+      Frame frame{&type, {}};
+      type.forEachChild([&](const std::shared_ptr<BType>& child) {
+        frame.children.push_back(child.get());
+      });
+      stack.push_back(std::move(frame));
+    };
+    m_info.try_emplace(&root);
+    enter(root);
+    while (!stack.empty()) {
+      Frame& frame = stack.back();
+      if (frame.next < frame.children.size()) {
+        const BType* child = frame.children[frame.next++];
+        auto [it, inserted] = m_info.try_emplace(child);
+        it->second.refs++;
+        if (inserted) enter(*child);
+        continue;
+      }
+      size_t size = 1;
+      for (const BType* child : frame.children) {
+        const size_t childSize = m_info[child].size;
+        size = childSize > SIZE_MAX - size ? SIZE_MAX : size + childSize;
+      }
+      m_info[frame.type].size = size;
+      m_postOrder.push_back(frame.type);
+      stack.pop_back();
+    }
+  }
+
+  // A piece of output still to be printed: a text, or a reference to a type
+  struct Item {
+    const BType* type;
+    std::string_view text;
+  };
+
+  // Prints the definition of a type, printing its sub-types by name when
+  // they are bound. Like analyze(), it keeps its own stack.
+  void body(const BType& type, std::string& out) {
+    std::vector<Item> stack;
+    expand(type, stack, out);
+    while (!stack.empty()) {
+      const Item item = stack.back();
+      stack.pop_back();
+      if (!item.type) {
+        out += item.text;
+        continue;
+      }
+      const Info& info = m_info[item.type];
+      if (info.name.empty())
+        expand(*item.type, stack, out);
+      else
+        out += info.name;
+    }
+  }
+
+  // Prints the beginning of the definition of a type, and pushes the rest of
+  // it on the stack, last piece first.
+  static void expand(const BType& type, std::vector<Item>& stack,
+                     std::string& out) {
+    switch (type.getKind()) {
+      case BType::Kind::ProductType: {
+        const auto& product = static_cast<const BType::ProductType&>(type);
+        out += "(";
+        stack.push_back({nullptr, ")"});
+        stack.push_back({product.rhs.get(), {}});
+        stack.push_back({nullptr, " × "});
+        stack.push_back({product.lhs.get(), {}});
+        break;
+      }
+      case BType::Kind::PowerType:
+        out += "ℙ(";
+        stack.push_back({nullptr, ")"});
+        stack.push_back(
+            {static_cast<const BType::PowerType&>(type).m_content.get(), {}});
+        break;
+      case BType::Kind::Struct: {
+        const auto& fields =
+            static_cast<const BType::StructType&>(type).m_fields;
+        out += "struct({";
+        stack.push_back({nullptr, "})"});
+        for (size_t i = fields.size(); i-- > 0;) {
+          stack.push_back({fields[i].second.get(), {}});
+          stack.push_back({nullptr, ": "});
+          stack.push_back({nullptr, fields[i].first});
+          if (i > 0) stack.push_back({nullptr, ", "});
+        }
+        break;
+      }
+      default:
+        out += fmt::format("{}", type);
+        break;
+    }
+  }
+
+  const size_t m_threshold;
+  size_t m_unindexed = 0;
+  std::unordered_map<const BType*, Info> m_info;
+  std::vector<const BType*> m_postOrder;
+};
+
+}  // namespace btypeFmt
+
+// Formatter for BTypeSharedFormat
+template <>
+struct fmt::formatter<BTypeSharedFormat> {
+  constexpr auto parse(format_parse_context& ctx) -> decltype(ctx.begin()) {
+    return ctx.begin();
+  }
+
+  template <typename FormatContext>
+  auto format(const BTypeSharedFormat& shared, FormatContext& ctx) const
+      -> decltype(ctx.out()) {
+    if (!shared.type) return fmt::format_to(ctx.out(), "nullptr");
+    btypeFmt::SharingPrinter printer(shared.threshold);
+    return fmt::format_to(ctx.out(), "{}", printer.print(*shared.type));
+  }
+};
+
 #endif  // BTYPE_FMT_H
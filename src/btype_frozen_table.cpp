@@ -0,0 +1,297 @@
+/* @file btype_frozen_table.cpp
+   @brief Implementation file for the BTypeFrozenTable and
+   BTypeReplicatedTable classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_frozen_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "btype_numa.h"
+
+namespace {
+
+uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+uint64_t hashString(std::string_view s) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (char c : s) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// Keeps the number of slots of the hash index within 32 bits
+constexpr size_t maxSize = size_t(1) << 30;
+
+bool isNamed(BType::Kind kind) {
+  return kind == BType::Kind::AbstractSet || kind == BType::Kind::EnumeratedSet;
+}
+
+}  // namespace
+
+// The structure of a type, as stored in the table. The strings are the name
+// and values of an enumerated set, the name of an abstract set, or the field
+// names of a struct. Abstract and enumerated sets are identified by their name
+// only, as in BTypeFactory.
+struct BTypeFrozenTable::Key {
+  BType::Kind kind;
+  const uint32_t *children;
+  uint32_t nbChildren;
+  const std::string_view *strings;
+  uint32_t nbStrings;
+
+  uint64_t hash() const {
+    if (isNamed(kind)) return mix(hashString(strings[0]));
+    uint64_t h = mix(static_cast<uint64_t>(kind) + 1);
+    for (uint32_t i = 0; i < nbChildren; ++i) h = mix(h ^ children[i]);
+    for (uint32_t i = 0; i < nbStrings; ++i)
+      h = mix(h ^ hashString(strings[i]));
+    return h;
+  }
+};
+
+BTypeFrozenTable::BTypeFrozenTable() {
+  const size_t n = BTypeFactory::size();
+  if (n > maxSize) throw BTypeFactory::Exception("Type table too large");
+  auto types = std::make_shared<std::vector<std::shared_ptr<BType>>>();
+  types->reserve(n);
+  for (size_t i = 0; i < n; ++i) types->push_back(BTypeFactory::at(i));
+  m_types = types;
+
+  std::vector<uint8_t> kinds;
+  std::vector<uint32_t> childFirst{0}, children, stringFirst{0}, charFirst{0};
+  std::string chars;
+  kinds.reserve(n);
+  childFirst.reserve(n + 1);
+  stringFirst.reserve(n + 1);
+  auto addString = [&](const std::string &s) {
+    chars += s;
+    charFirst.push_back(static_cast<uint32_t>(chars.size()));
+  };
+  for (const auto &type : *types) {
+    kinds.push_back(static_cast<uint8_t>(type->getKind()));
+    type->forEachChild([&](const std::shared_ptr<BType> &child) {
+      children.push_back(static_cast<uint32_t>(child->index()));
+    });
+    childFirst.push_back(static_cast<uint32_t>(children.size()));
+    switch (type->getKind()) {
+      case BType::Kind::AbstractSet:
+        addString(type->asAbstractSetType()->getName());
+        break;
+      case BType::Kind::EnumeratedSet: {
+        const auto set = type->asEnumeratedSetType();
+        addString(set->getName());
+        for (const auto &value : set->getValues()) addString(value);
+        break;
+      }
+      case BType::Kind::Struct:
+        for (const auto &field : type->asStructType()->getFields())
+          addString(field.first);
+        break;
+      default:
+        break;
+    }
+    stringFirst.push_back(static_cast<uint32_t>(charFirst.size() - 1));
+    if (children.size() >= npos || chars.size() >= npos)
+      throw BTypeFactory::Exception("Type table too large");
+  }
+
+  m_size = static_cast<uint32_t>(n);
+  m_nbChildren = static_cast<uint32_t>(children.size());
+  m_nbStrings = static_cast<uint32_t>(charFirst.size() - 1);
+  m_nbChars = static_cast<uint32_t>(chars.size());
+  // At most half full, so that probe sequences stay short
+  m_nbSlots = 2;
+  while (m_nbSlots < 2 * m_size) m_nbSlots *= 2;
+  m_bytes = 0;
+  bind();
+  m_block = static_cast<std::byte *>(btypeNuma::allocate(m_bytes));
+  bind();
+
+  for (uint32_t i = 0; i < m_size; ++i) m_nodes[i] = (*types)[i].get();
+  std::copy(kinds.begin(), kinds.end(), m_kinds);
+  std::copy(childFirst.begin(), childFirst.end(), m_childFirst);
+  std::copy(children.begin(), children.end(), m_children);
+  std::copy(stringFirst.begin(), stringFirst.end(), m_stringFirst);
+  std::copy(charFirst.begin(), charFirst.end(), m_charFirst);
+  std::copy(chars.begin(), chars.end(), m_chars);
+  std::fill(m_slots, m_slots + m_nbSlots, npos);
+
+  std::vector<std::string_view> strings;
+  for (uint32_t i = 0; i < m_size; ++i) {
+    strings.clear();
+    for (uint32_t s = m_stringFirst[i]; s < m_stringFirst[i + 1]; ++s)
+      strings.push_back(string(s));
+    const Key key{kind(i), m_children + m_childFirst[i], arity(i),
+                  strings.data(), static_cast<uint32_t>(strings.size())};
+    m_hashes[i] = key.hash();
+    uint32_t slot = static_cast<uint32_t>(m_hashes[i]) & (m_nbSlots - 1);
+    while (m_slots[slot] != npos) slot = (slot + 1) & (m_nbSlots - 1);
+    m_slots[slot] = i;
+  }
+}
+
+BTypeFrozenTable::BTypeFrozenTable(const BTypeFrozenTable &other)
+    : m_types{other.m_types},
+      m_size{other.m_size},
+      m_nbChildren{other.m_nbChildren},
+      m_nbStrings{other.m_nbStrings},
+      m_nbChars{other.m_nbChars},
+      m_nbSlots{other.m_nbSlots},
+      m_bytes{other.m_bytes} {
+  m_block = static_cast<std::byte *>(btypeNuma::allocate(m_bytes));
+  std::memcpy(m_block, other.m_block, m_bytes);
+  bind();
+}
+
+BTypeFrozenTable::~BTypeFrozenTable() {
+  btypeNuma::deallocate(m_block, m_bytes);
+}
+
+// Lays the arrays out in m_block, largest alignment first. When m_block is not
+// yet allocated, only computes m_bytes.
+void BTypeFrozenTable::bind() {
+  size_t offset = 0;
+  auto place = [&](auto *&array, size_t count) {
+    using T = std::remove_reference_t<decltype(*array)>;
+    offset = (offset + alignof(T) - 1) / alignof(T) * alignof(T);
+    if (m_block != nullptr) array = reinterpret_cast<T *>(m_block + offset);
+    offset += count * sizeof(T);
+  };
+  place(m_nodes, m_size);
+  place(m_hashes, m_size);
+  place(m_childFirst, m_size + 1);
+  place(m_children, m_nbChildren);
+  place(m_stringFirst, m_size + 1);
+  place(m_charFirst, m_nbStrings + 1);
+  place(m_slots, m_nbSlots);
+  place(m_kinds, m_size);
+  place(m_chars, m_nbChars);
+  m_bytes = offset;
+}
+
+std::string_view BTypeFrozenTable::string(uint32_t position) const {
+  return std::string_view(m_chars + m_charFirst[position],
+                          m_charFirst[position + 1] - m_charFirst[position]);
+}
+
+std::string_view BTypeFrozenTable::name(uint32_t index) const {
+  if (!isNamed(kind(index))) return {};
+  return string(m_stringFirst[index]);
+}
+
+uint32_t BTypeFrozenTable::nbLabels(uint32_t index) const {
+  const uint32_t count = m_stringFirst[index + 1] - m_stringFirst[index];
+  return isNamed(kind(index)) ? count - 1 : count;
+}
+
+std::string_view BTypeFrozenTable::label(uint32_t index,
+                                         uint32_t position) const {
+  const uint32_t first = m_stringFirst[index] + (isNamed(kind(index)) ? 1 : 0);
+  return string(first + position);
+}
+
+bool BTypeFrozenTable::matches(uint32_t index, const Key &key) const {
+  if (isNamed(key.kind))
+    return isNamed(kind(index)) && name(index) == key.strings[0];
+  if (kind(index) != key.kind || arity(index) != key.nbChildren ||
+      m_stringFirst[index + 1] - m_stringFirst[index] != key.nbStrings)
+    return false;
+  for (uint32_t i = 0; i < key.nbChildren; ++i) {
+    if (child(index, i) != key.children[i]) return false;
+  }
+  for (uint32_t i = 0; i < key.nbStrings; ++i) {
+    if (string(m_stringFirst[index] + i) != key.strings[i]) return false;
+  }
+  return true;
+}
+
+// Types were inserted in index order, so among several matching types the
+// first one found along the probe sequence is the first created.
+uint32_t BTypeFrozenTable::find(const Key &key) const {
+  const uint64_t hash = key.hash();
+  uint32_t slot = static_cast<uint32_t>(hash) & (m_nbSlots - 1);
+  for (; m_slots[slot] != npos; slot = (slot + 1) & (m_nbSlots - 1)) {
+    const uint32_t index = m_slots[slot];
+    if (m_hashes[index] == hash && matches(index, key)) return index;
+  }
+  return npos;
+}
+
+uint32_t BTypeFrozenTable::findProduct(uint32_t lhs, uint32_t rhs) const {
+  const uint32_t children[] = {lhs, rhs};
+  return find(Key{BType::Kind::ProductType, children, 2, nullptr, 0});
+}
+
+uint32_t BTypeFrozenTable::findPowerSet(uint32_t content) const {
+  return find(Key{BType::Kind::PowerType, &content, 1, nullptr, 0});
+}
+
+uint32_t BTypeFrozenTable::findNamed(std::string_view name) const {
+  return find(Key{BType::Kind::AbstractSet, nullptr, 0, &name, 1});
+}
+
+uint32_t BTypeFrozenTable::findStruct(
+    std::vector<std::pair<std::string_view, uint32_t>> fields) const {
+  std::sort(fields.begin(), fields.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  std::vector<uint32_t> children;
+  std::vector<std::string_view> names;
+  for (const auto &field : fields) {
+    names.push_back(field.first);
+    children.push_back(field.second);
+  }
+  const auto size = static_cast<uint32_t>(fields.size());
+  return find(Key{BType::Kind::Struct, children.data(), size, names.data(),
+                  size});
+}
+
+BTypeReplicatedTable::BTypeReplicatedTable(unsigned nbReplicas) {
+  const unsigned nbNodes = static_cast<unsigned>(btypeNuma::nodes().size());
+  if (nbReplicas == 0) nbReplicas = nbNodes;
+  auto snapshot = std::make_unique<BTypeFrozenTable>();
+  m_replicas.resize(nbReplicas);
+  // With a single node, the snapshot is already local and serves as the
+  // first copy.
+  unsigned first = 0;
+  if (nbNodes == 1) {
+    m_replicas[0] = std::move(snapshot);
+    first = 1;
+  }
+  const BTypeFrozenTable &source = snapshot ? *snapshot : *m_replicas[0];
+  for (unsigned k = first; k < nbReplicas; ++k) {
+    btypeNuma::runOnNode(k % nbNodes, [&] {
+      m_replicas[k] = std::make_unique<BTypeFrozenTable>(source);
+    });
+  }
+}
+
+const BTypeFrozenTable &BTypeReplicatedTable::local() const {
+  return *m_replicas[btypeNuma::currentNode() % m_replicas.size()];
+}
@@ -0,0 +1,206 @@
+/* @file btype_frozen_table.h
+   @brief Header file for the BTypeFrozenTable and BTypeReplicatedTable
+   classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_FROZEN_TABLE_H
+#define BTYPE_FROZEN_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "btype.h"
+
+/**
+ * @brief Compact, read-only copy of the BTypeFactory table.
+ *
+ * The table is taken at construction: the types at indices 0 to size()-1.
+ * It is stored in a single block of memory, as arrays indexed by type index
+ * (kind, sub-types, names), together with pointers to the BType nodes and a
+ * hash index to look types up by structure. Types are designated by their
+ * index in the BTypeFactory table.
+ *
+ * All methods are const and may be called concurrently.
+ */
+class BTypeFrozenTable {
+ public:
+  /** @brief Result of the lookups when no type matches. */
+  static constexpr uint32_t npos = UINT32_MAX;
+
+  /**
+   * @brief Takes a snapshot of the type table.
+   * @throw BTypeFactory::Exception if the table has more than 2^30 types
+   */
+  BTypeFrozenTable();
+  /**
+   * @brief Copies a table into a new block of memory. The pages of the block
+   * are written for the first time by the calling thread, so the kernel
+   * places them on the NUMA node of that thread.
+   */
+  BTypeFrozenTable(const BTypeFrozenTable &other);
+  BTypeFrozenTable &operator=(const BTypeFrozenTable &) = delete;
+  ~BTypeFrozenTable();
+
+  /** @brief Gets the number of types in the table. */
+  uint32_t size() const { return m_size; }
+  /** @brief Gets the size in bytes of the block holding the table. */
+  size_t bytes() const { return m_bytes; }
+
+  /** @brief Gets the kind of a type. */
+  BType::Kind kind(uint32_t index) const {
+    return static_cast<BType::Kind>(m_kinds[index]);
+  }
+  /**
+   * @brief Gets the number of sub-types of a type: 2 for a product, 1 for a
+   * power set, the number of fields for a struct, 0 otherwise.
+   */
+  uint32_t arity(uint32_t index) const {
+    return m_childFirst[index + 1] - m_childFirst[index];
+  }
+  /**
+   * @brief Gets a sub-type of a type, in the order of BType::forEachChild.
+   * @param index the type
+   * @param position a position less than arity(index)
+   */
+  uint32_t child(uint32_t index, uint32_t position) const {
+    return m_children[m_childFirst[index] + position];
+  }
+  /** @brief Gets the name of an abstract or enumerated set, "" otherwise. */
+  std::string_view name(uint32_t index) const;
+  /**
+   * @brief Gets the number of labels of a type: the values of an enumerated
+   * set, the field names of a struct, 0 otherwise.
+   */
+  uint32_t nbLabels(uint32_t index) const;
+  /**
+   * @brief Gets a label of a type.
+   * @param index the type
+   * @param position a position less than nbLabels(index)
+   */
+  std::string_view label(uint32_t index, uint32_t position) const;
+
+  /**
+   * @brief Gets the node of a type.
+   * @note The node is the single BType of the factory, shared by all the
+   * copies of the table: in a BTypeReplicatedTable, it may be on another NUMA
+   * node than the replica. Only the arrays read by the other accessors and
+   * by the lookups are local to the replica.
+   */
+  const BType &node(uint32_t index) const { return *m_nodes[index]; }
+  /**
+   * @brief Gets a shared pointer to the node of a type.
+   * @note As for node(), the node is shared by all the copies of the table.
+   */
+  const std::shared_ptr<BType> &at(uint32_t index) const {
+    return (*m_types)[index];
+  }
+
+  /** @brief Looks a product up by its operands; npos if absent. */
+  uint32_t findProduct(uint32_t lhs, uint32_t rhs) const;
+  /** @brief Looks a power set up by its content; npos if absent. */
+  uint32_t findPowerSet(uint32_t content) const;
+  /**
+   * @brief Looks an abstract or enumerated set up by name; npos if absent. If
+   * both exist, the first created is returned.
+   */
+  uint32_t findNamed(std::string_view name) const;
+  /**
+   * @brief Looks a struct up by its fields, given in any order; npos if
+   * absent.
+   */
+  uint32_t findStruct(
+      std::vector<std::pair<std::string_view, uint32_t>> fields) const;
+
+ private:
+  struct Key;
+  void bind();
+  uint32_t find(const Key &key) const;
+  bool matches(uint32_t index, const Key &key) const;
+  std::string_view string(uint32_t position) const;
+
+  // Keeps the nodes alive; shared by the copies of the table
+  std::shared_ptr<const std::vector<std::shared_ptr<BType>>> m_types;
+  uint32_t m_size = 0;
+  uint32_t m_nbChildren = 0;
+  uint32_t m_nbStrings = 0;
+  uint32_t m_nbChars = 0;
+  uint32_t m_nbSlots = 0;
+  size_t m_bytes = 0;
+  std::byte *m_block = nullptr;
+
+  // Arrays within m_block
+  const BType **m_nodes = nullptr;
+  uint64_t *m_hashes = nullptr;
+  uint32_t *m_childFirst = nullptr;
+  uint32_t *m_children = nullptr;
+  uint32_t *m_stringFirst = nullptr;
+  uint32_t *m_charFirst = nullptr;
+  uint32_t *m_slots = nullptr;
+  uint8_t *m_kinds = nullptr;
+  char *m_chars = nullptr;
+};
+
+/**
+ * @brief One copy of a BTypeFrozenTable per NUMA node.
+ *
+ * Each copy is made by a thread bound to the CPUs of its node, so that its
+ * memory is local to that node. Readers call local() to get the copy of the
+ * node they run on. On a machine with a single node, or when the topology
+ * cannot be read, there is a single copy.
+ *
+ * Only the arrays of the table are copied: the kinds, hashes, children,
+ * names and labels, and the lookup slots. The BType nodes are not, since a
+ * node is the identity of its type: replica(k).node(i) and replica(k).at(i)
+ * return the same node for every k, in the memory where the factory created
+ * it, which may be on another NUMA node.
+ *
+ * @code
+ * BTypeReplicatedTable table;
+ * // in any thread
+ * const BTypeFrozenTable &types = table.local();
+ * @endcode
+ */
+class BTypeReplicatedTable {
+ public:
+  /**
+   * @brief Takes a snapshot of the type table and copies it.
+   * @param nbReplicas number of copies; 0 means one per NUMA node. Copy k is
+   * placed on node k modulo the number of nodes, and threads of node n read
+   * copy n modulo nbReplicas.
+   */
+  explicit BTypeReplicatedTable(unsigned nbReplicas = 0);
+
+  /** @brief Gets the number of copies. */
+  unsigned nbReplicas() const {
+    return static_cast<unsigned>(m_replicas.size());
+  }
+  /** @brief Gets a copy. */
+  const BTypeFrozenTable &replica(unsigned position) const {
+    return *m_replicas[position];
+  }
+  /** @brief Gets the copy for the NUMA node of the calling thread. */
+  const BTypeFrozenTable &local() const;
+
+ private:
+  std::vector<std::unique_ptr<BTypeFrozenTable>> m_replicas;
+};
+
+#endif  // BTYPE_FROZEN_TABLE_H
@@ -0,0 +1,227 @@
+/* @file btype_hash_cons.h
+   @brief Header file for the HashConsTable class template.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_HASH_CONS_H
+#define BTYPE_HASH_CONS_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+/** @brief Error raised by a HashConsTable for a new key once it is frozen. */
+class HashConsError : public std::logic_error {
+ public:
+  using std::logic_error::logic_error;
+};
+
+/**
+ * @brief Concurrent table of unique nodes, indexed by a key describing their
+ * structure (hash-consing).
+ *
+ * intern() returns the node of a key, creating it on first request, so that
+ * there is a single node per key. When the key of a node is made of its
+ * children's nodes, compared by pointer, and all nodes are created through
+ * the table, structurally equal trees are the same object (maximal sharing).
+ *
+ * Lookups take a shared lock; creations take the exclusive lock and check
+ * again, so that concurrent requests for the same key create a single node.
+ * Once frozen, the table rejects new keys and lookups take no lock at all.
+ *
+ * Example, for the nodes of an expression language:
+ * @code
+ * HashConsTable<std::pair<const Expr *, const Expr *>, Expr, PairHash> sums;
+ * std::shared_ptr<Expr> sum = sums.intern({a.get(), b.get()}, [&] {
+ *   return std::make_shared<Expr>(Expr::SUM, a, b);
+ * });
+ * @endcode
+ *
+ * @tparam Key the key of a node; it must be copyable
+ * @tparam Node the type of the nodes, held by std::shared_ptr
+ * @tparam Hash hash function object for Key
+ * @tparam KeyEqual equality function object for Key
+ */
+template <typename Key, typename Node, typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class HashConsTable {
+ public:
+  /**
+   * @brief Function called on each new node, with the exclusive lock held,
+   * before the node is visible to other threads. Typically assigns an index
+   * to the node.
+   */
+  using OnCreate = std::function<void(const std::shared_ptr<Node> &)>;
+
+  /** @brief Counters of a table. */
+  struct Stats {
+    /** @brief Number of nodes. */
+    size_t size = 0;
+    /** @brief Number of buckets of the underlying hash table. */
+    size_t buckets = 0;
+    /** @brief Number of intern() and find() calls; 0 unless collectStats. */
+    size_t lookups = 0;
+    /** @brief Number of nodes created by intern(). */
+    size_t creations = 0;
+  };
+
+  /**
+   * @param onCreate function called on each new node, or nullptr
+   * @param collectStats whether to count lookups. Creations are always
+   * counted, lookups only on demand since counting them makes all threads
+   * write to the same cache line.
+   * @param hash the hash function object
+   * @param equal the equality function object
+   */
+  explicit HashConsTable(OnCreate onCreate = nullptr, bool collectStats = false,
+                         const Hash &hash = Hash(),
+                         const KeyEqual &equal = KeyEqual())
+      : m_onCreate{std::move(onCreate)},
+        m_collectStats{collectStats},
+        m_nodes(0, hash, equal) {}
+  HashConsTable(const HashConsTable &) = delete;
+  HashConsTable &operator=(const HashConsTable &) = delete;
+
+  /**
+   * @brief Gets the node of a key, creating it if needed.
+   * @param key the key
+   * @param make a callable returning a std::shared_ptr to a new node for the
+   * key; it is called at most once, with the exclusive lock held
+   * @return the unique node of the key
+   * @throw HashConsError if the key is new and the table is frozen
+   */
+  template <typename Make>
+  std::shared_ptr<Node> intern(const Key &key, Make &&make) {
+    if (std::shared_ptr<Node> node = find(key)) return node;
+    std::unique_lock<std::shared_mutex> writeLock(m_mutex);
+    return internLocked(key, make, true).first;
+  }
+
+  /**
+   * @brief Exclusive access to a table, to intern several keys under a single
+   * lock. Nodes created by a batch are not visible to other threads before
+   * the batch is destroyed; the OnCreate function is not called for them.
+   */
+  class Batch {
+   public:
+    explicit Batch(HashConsTable &table)
+        : m_table{table}, m_writeLock{table.m_mutex} {}
+
+    /**
+     * @brief Gets the node of a key, creating it if needed.
+     * @return the node, and whether it was created
+     * @throw HashConsError if the key is new and the table is frozen
+     */
+    template <typename Make>
+    std::pair<std::shared_ptr<Node>, bool> intern(const Key &key,
+                                                  Make &&make) {
+      return m_table.internLocked(key, make, false);
+    }
+
+   private:
+    HashConsTable &m_table;
+    std::unique_lock<std::shared_mutex> m_writeLock;
+  };
+
+  /**
+   * @brief Gets the node of a key, without creating it.
+   * @return the node, or nullptr if there is none
+   */
+  std::shared_ptr<Node> find(const Key &key) const {
+    if (m_collectStats) m_lookups.fetch_add(1, std::memory_order_relaxed);
+    if (m_frozen.load(std::memory_order_acquire)) return lookup(key);
+    std::shared_lock<std::shared_mutex> readLock(m_mutex);
+    return lookup(key);
+  }
+
+  /** @brief Gets the number of nodes. */
+  size_t size() const {
+    std::shared_lock<std::shared_mutex> readLock(m_mutex);
+    return m_nodes.size();
+  }
+
+  /** @brief Gets the counters of the table. */
+  Stats stats() const {
+    std::shared_lock<std::shared_mutex> readLock(m_mutex);
+    Stats result;
+    result.size = m_nodes.size();
+    result.buckets = m_nodes.bucket_count();
+    result.lookups = m_lookups.load(std::memory_order_relaxed);
+    result.creations = m_creations;
+    return result;
+  }
+
+  /**
+   * @brief Forbids the creation of new nodes. Lookups no longer take a lock.
+   * Freezing is definitive.
+   */
+  void freeze() {
+    std::unique_lock<std::shared_mutex> writeLock(m_mutex);
+    m_frozen.store(true, std::memory_order_release);
+  }
+
+  /** @brief Tells whether the table is frozen. */
+  bool frozen() const { return m_frozen.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Applies a function to each key and node, in no particular order.
+   * @param f a callable with signature void(const Key &, const
+   * std::shared_ptr<Node> &); it must not call the table
+   */
+  template <typename F>
+  void forEach(F &&f) const {
+    std::shared_lock<std::shared_mutex> readLock(m_mutex);
+    for (const auto &entry : m_nodes) f(entry.first, entry.second);
+  }
+
+ private:
+  // Gets or creates the node of a key, with the exclusive lock held
+  template <typename Make>
+  std::pair<std::shared_ptr<Node>, bool> internLocked(const Key &key,
+                                                      Make &make,
+                                                      bool onCreate) {
+    auto it = m_nodes.find(key);
+    if (it != m_nodes.end()) return {it->second, false};
+    if (m_frozen.load(std::memory_order_relaxed))
+      throw HashConsError("New node in a frozen table");
+    std::shared_ptr<Node> node = make();
+    if (onCreate && m_onCreate) m_onCreate(node);
+    m_nodes.emplace(key, node);
+    ++m_creations;
+    return {node, true};
+  }
+
+  std::shared_ptr<Node> lookup(const Key &key) const {
+    auto it = m_nodes.find(key);
+    return it == m_nodes.end() ? nullptr : it->second;
+  }
+
+  const OnCreate m_onCreate;
+  const bool m_collectStats;
+  mutable std::shared_mutex m_mutex;
+  std::atomic<bool> m_frozen{false};
+  size_t m_creations = 0;
+  mutable std::atomic<size_t> m_lookups{0};
+  std::unordered_map<Key, std::shared_ptr<Node>, Hash, KeyEqual> m_nodes;
+};
+
+#endif  // BTYPE_HASH_CONS_H
@@ -0,0 +1,103 @@
+/* @file btype_index_memo.h
+   @brief Header file for the BTypeIndexMemo class template.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_INDEX_MEMO_H
+#define BTYPE_INDEX_MEMO_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+
+#include "btype.h"
+
+/**
+ * @brief Thread-safe memo of a value computed from a type, stored by type
+ * index.
+ *
+ * Types of the BTypeFactory table are never removed and their indices never
+ * change, so that a value computed once for a type holds for the rest of the
+ * program. Types that are not in the table, such as the types of a
+ * BTypeStaging builder, have no index: their value is computed on each
+ * request and not kept, since the type may be discarded and its address
+ * reused.
+ *
+ * Lookups take a shared lock. A value is computed without lock, so that the
+ * computation may get the values of other types; when two threads compute
+ * the value of the same type, the first one stored is kept.
+ *
+ * @code
+ * static BTypeIndexMemo<std::shared_ptr<const Layout>> memo;
+ * return memo.get(*type, [&] { return std::make_shared<Layout>(type); });
+ * @endcode
+ *
+ * @tparam T the type of the values; it must be copyable
+ */
+template <typename T>
+class BTypeIndexMemo {
+ public:
+  /**
+   * @brief Gets the value of a type, computing it on first request.
+   * @param compute a callable returning the value of the type
+   */
+  template <typename Compute>
+  T get(const BType &type, Compute &&compute) {
+    const size_t index = type.index();
+    if (index == SIZE_MAX) return compute();
+    {
+      std::shared_lock<std::shared_mutex> readLock(m_mutex);
+      if (index < m_values.size() && m_values[index]) return *m_values[index];
+    }
+    T value = compute();
+    std::unique_lock<std::shared_mutex> writeLock(m_mutex);
+    if (m_values.size() <= index) m_values.resize(index + 1);
+    if (!m_values[index]) m_values[index] = std::move(value);
+    return *m_values[index];
+  }
+
+  /**
+   * @brief Gets the value of a type, computing first the missing values of
+   * the types before it in the table, in index order. The sub-types of a type
+   * of the table are before it, so that compute may get their values from
+   * the memo without recursing down the type.
+   * @param compute a callable taking a const BType & and returning its value
+   */
+  template <typename Compute>
+  T getInIndexOrder(const BType &type, Compute &&compute) {
+    const size_t index = type.index();
+    if (index == SIZE_MAX) return compute(type);
+    for (size_t i = m_prefix.load(std::memory_order_acquire); i < index; ++i) {
+      const std::shared_ptr<BType> previous = BTypeFactory::at(i);
+      get(*previous, [&] { return compute(*previous); });
+      size_t expected = i;
+      m_prefix.compare_exchange_strong(expected, i + 1,
+                                       std::memory_order_acq_rel);
+    }
+    return get(type, [&] { return compute(type); });
+  }
+
+ private:
+  std::shared_mutex m_mutex;
+  std::vector<std::optional<T>> m_values;
+  // Number of leading indices whose values are known to be computed
+  std::atomic<size_t> m_prefix{0};
+};
+
+#endif  // BTYPE_INDEX_MEMO_H
@@ -0,0 +1,166 @@
+/* @file btype_numa.cpp
+   @brief Implementation of the NUMA helpers.
+
+   Only Linux is supported: the topology is read from sysfs, threads are bound
+   with sched_setaffinity and memory is obtained with mmap. On other systems,
+   there is a single node and memory comes from operator new.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_numa.h"
+
+#include <exception>
+#include <new>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#endif
+
+namespace {
+
+struct Topology {
+  std::vector<std::vector<unsigned>> nodes;
+  std::vector<unsigned> nodeOfCpu;
+};
+
+#ifdef __linux__
+// Parses a sysfs CPU list such as "0-3,8,10-11"
+std::vector<unsigned> parseCpuList(const std::string &text) {
+  std::vector<unsigned> cpus;
+  std::istringstream is(text);
+  std::string range;
+  while (std::getline(is, range, ',')) {
+    const char *p = range.c_str();
+    char *end;
+    const unsigned long first = std::strtoul(p, &end, 10);
+    if (end == p) continue;
+    unsigned long last = first;
+    if (*end == '-') last = std::strtoul(end + 1, nullptr, 10);
+    for (unsigned long cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(static_cast<unsigned>(cpu));
+  }
+  return cpus;
+}
+#endif
+
+Topology readTopology() {
+  Topology topology;
+#ifdef __linux__
+  // Node numbers may have gaps; nodes without CPUs (memory only) are skipped.
+  std::vector<unsigned> online;
+  {
+    std::ifstream is("/sys/devices/system/node/online");
+    std::string text;
+    if (std::getline(is, text)) online = parseCpuList(text);
+  }
+  for (unsigned node : online) {
+    std::ifstream is("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist");
+    std::string text;
+    if (!std::getline(is, text)) continue;
+    std::vector<unsigned> cpus = parseCpuList(text);
+    if (cpus.empty()) continue;
+    for (unsigned cpu : cpus) {
+      if (topology.nodeOfCpu.size() <= cpu) topology.nodeOfCpu.resize(cpu + 1);
+      topology.nodeOfCpu[cpu] = static_cast<unsigned>(topology.nodes.size());
+    }
+    topology.nodes.push_back(std::move(cpus));
+  }
+#endif
+  if (topology.nodes.empty()) topology.nodes.emplace_back();
+  return topology;
+}
+
+const Topology &topology() {
+  static const Topology instance = readTopology();
+  return instance;
+}
+
+}  // namespace
+
+namespace btypeNuma {
+
+const std::vector<std::vector<unsigned>> &nodes() { return topology().nodes; }
+
+unsigned currentNode() {
+#ifdef __linux__
+  const Topology &t = topology();
+  if (t.nodes.size() == 1) return 0;
+  const int cpu = sched_getcpu();
+  if (cpu >= 0 && static_cast<size_t>(cpu) < t.nodeOfCpu.size())
+    return t.nodeOfCpu[cpu];
+#endif
+  return 0;
+}
+
+void runOnNode(unsigned node, const std::function<void()> &f) {
+  const std::vector<unsigned> &cpus = nodes().at(node);
+  if (cpus.empty()) {
+    f();
+    return;
+  }
+  std::exception_ptr error;
+  std::thread thread([&] {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : cpus) {
+      if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    // If binding fails (restricted cpuset), the copy is still correct, only
+    // possibly remote.
+    sched_setaffinity(0, sizeof set, &set);
+#endif
+    try {
+      f();
+    } catch (...) {
+      error = std::current_exception();
+    }
+  });
+  thread.join();
+  if (error) std::rethrow_exception(error);
+}
+
+void *allocate(size_t bytes) {
+  if (bytes == 0) return nullptr;
+#ifdef __linux__
+  void *block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (block == MAP_FAILED) throw std::bad_alloc();
+  return block;
+#else
+  return ::operator new(bytes);
+#endif
+}
+
+void deallocate(void *block, size_t bytes) {
+  if (block == nullptr) return;
+#ifdef __linux__
+  munmap(block, bytes);
+#else
+  (void)bytes;
+  ::operator delete(block);
+#endif
+}
+
+}  // namespace btypeNuma
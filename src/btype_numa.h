@@ -0,0 +1,75 @@
+/* @file btype_numa.h
+   @brief Internal helpers to discover the NUMA topology of the machine and to
+   place memory on a given node.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_NUMA_H
+#define BTYPE_NUMA_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace btypeNuma {
+
+/**
+ * @brief Gets the CPUs of each NUMA node.
+ * @return the CPU numbers of each node with CPUs, read once from
+ * /sys/devices/system/node. When the topology is unknown (not Linux, no sysfs)
+ * a single node is reported, with an empty list of CPUs.
+ */
+const std::vector<std::vector<unsigned>> &nodes();
+
+/**
+ * @brief Gets the node of the CPU the calling thread currently runs on.
+ * @return a position in nodes(), 0 if it cannot be determined
+ */
+unsigned currentNode();
+
+/**
+ * @brief Runs a function on a thread bound to the CPUs of a node, and waits
+ * for it.
+ *
+ * Memory written for the first time by f is then placed on that node by the
+ * first-touch policy of the kernel. If the node has no known CPUs, f is run
+ * on the calling thread.
+ *
+ * @param node a position in nodes()
+ * @param f the function to run
+ * @throw the exception raised by f, if any
+ */
+void runOnNode(unsigned node, const std::function<void()> &f);
+
+/**
+ * @brief Allocates memory whose pages are not yet touched, so that each page
+ * is placed on the node of the first thread writing to it.
+ * @param bytes the size of the block
+ * @return the block, aligned for any type; nullptr if bytes is 0
+ * @throw std::bad_alloc if the allocation fails
+ */
+void *allocate(size_t bytes);
+
+/**
+ * @brief Releases a block obtained from allocate().
+ * @param block the block
+ * @param bytes the size given to allocate()
+ */
+void deallocate(void *block, size_t bytes);
+
+}  // namespace btypeNuma
+
+#endif  // BTYPE_NUMA_H
@@ -0,0 +1,185 @@
+/* @file btype_parallel.cpp
+   @brief Implementation file for the level-synchronous work-stealing helpers.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <thread>
+
+namespace {
+
+/** @brief Reusable barrier (std::barrier is C++20). */
+class Barrier {
+ public:
+  explicit Barrier(unsigned count) : m_count{count} {}
+  void wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const size_t generation = m_generation;
+    if (++m_waiting == m_count) {
+      m_waiting = 0;
+      ++m_generation;
+      m_cv.notify_all();
+      return;
+    }
+    m_cv.wait(lock, [&] { return generation != m_generation; });
+  }
+
+ private:
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  const unsigned m_count;
+  unsigned m_waiting = 0;
+  size_t m_generation = 0;
+};
+
+/** @brief The positions of a level that are still to be processed by one
+ * thread. Other threads may steal the upper half. */
+struct alignas(64) Share {
+  std::mutex mutex;
+  size_t lo = 0;
+  size_t hi = 0;
+};
+
+}  // namespace
+
+namespace btypeParallel {
+
+unsigned defaultThreads() {
+  const unsigned n = std::thread::hardware_concurrency();
+  return n == 0 ? 1 : n;
+}
+
+void runLevels(const std::vector<std::vector<size_t>> &levels,
+               unsigned nbThreads, const std::function<void(size_t)> &body) {
+  if (nbThreads == 0) nbThreads = defaultThreads();
+  size_t widest = 0;
+  for (const auto &level : levels) widest = std::max(widest, level.size());
+  const unsigned wanted =
+      static_cast<unsigned>(std::min<size_t>(nbThreads, widest));
+  if (wanted <= 1) {
+    for (const auto &level : levels)
+      for (size_t elem : level) body(elem);
+    return;
+  }
+
+  // The number of threads taking part, known once they are started
+  unsigned n = wanted;
+  std::vector<Share> shares(wanted);
+  std::optional<Barrier> barrier;
+  std::atomic<bool> failed{false};
+  std::exception_ptr error;
+  std::mutex errorMutex;
+
+  auto work = [&](unsigned self, const std::vector<size_t> &level,
+                  size_t grain) {
+    Share &own = shares[self];
+    while (!failed.load(std::memory_order_relaxed)) {
+      size_t lo = 0, hi = 0;
+      {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        lo = own.lo;
+        hi = std::min(own.hi, lo + grain);
+        own.lo = hi;
+      }
+      if (lo == hi) {
+        // Own share is exhausted: steal half of a victim's remaining work.
+        bool stolen = false;
+        for (unsigned k = 1; k < n && !stolen; ++k) {
+          Share &victim = shares[(self + k) % n];
+          std::lock_guard<std::mutex> lock(victim.mutex);
+          const size_t left = victim.hi - victim.lo;
+          if (left == 0) continue;
+          const size_t mid = left <= grain ? victim.lo : victim.lo + left / 2;
+          lo = mid;
+          hi = victim.hi;
+          victim.hi = mid;
+          stolen = true;
+        }
+        if (!stolen) return;
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.lo = lo;
+        own.hi = hi;
+        continue;
+      }
+      try {
+        for (size_t pos = lo; pos < hi; ++pos) body(level[pos]);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error) error = std::current_exception();
+        failed.store(true, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  auto run = [&](unsigned self) {
+    for (const auto &level : levels) {
+      const size_t size = level.size();
+      if (size == 0) continue;
+      const size_t grain =
+          std::max<size_t>(1, std::min<size_t>(256, size / (8 * n)));
+      {
+        std::lock_guard<std::mutex> lock(shares[self].mutex);
+        shares[self].lo = size * self / n;
+        shares[self].hi = size * (self + 1) / n;
+      }
+      barrier->wait();
+      work(self, level, grain);
+      barrier->wait();
+    }
+  };
+
+  // The threads are created for this call and joined before it returns.
+  // They wait at a gate until all of them are started: if the system refuses
+  // to start one, the work is shared among the threads that did start.
+  std::mutex gateMutex;
+  std::condition_variable gate;
+  bool open = false;
+  auto start = [&](unsigned self) {
+    {
+      std::unique_lock<std::mutex> lock(gateMutex);
+      gate.wait(lock, [&] { return open; });
+    }
+    run(self);
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(wanted - 1);
+  try {
+    for (unsigned t = 1; t < wanted; ++t) threads.emplace_back(start, t);
+  } catch (const std::system_error &) {
+  }
+  {
+    std::lock_guard<std::mutex> lock(gateMutex);
+    n = static_cast<unsigned>(threads.size()) + 1;
+    barrier.emplace(n);
+    open = true;
+  }
+  gate.notify_all();
+  run(0);
+  for (auto &thread : threads) thread.join();
+  if (error) std::rethrow_exception(error);
+}
+
+}  // namespace btypeParallel
@@ -0,0 +1,58 @@
+/* @file btype_parallel.h
+   @brief Internal helpers to run work over levels of indices on several
+   threads.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_PARALLEL_H
+#define BTYPE_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace btypeParallel {
+
+/**
+ * @brief Number of threads used when the caller asks for 0 threads.
+ * @return std::thread::hardware_concurrency(), or 1 if it is unknown.
+ */
+unsigned defaultThreads();
+
+/**
+ * @brief Applies a function to every element of a sequence of levels.
+ *
+ * Levels are processed one after the other: every call for level k returns
+ * before any call for level k+1 starts. Elements of the same level are
+ * distributed among the threads; each thread works on its own share and
+ * steals from the others when it runs out of work.
+ *
+ * The threads are started by each call and joined before it returns; there
+ * is no pool kept between calls. When a thread cannot be started, the work is
+ * done by the threads that could.
+ *
+ * @param levels the elements (typically indices) grouped by level
+ * @param nbThreads number of threads to use, including the calling thread; 0
+ * means defaultThreads()
+ * @param body the function applied to each element
+ * @throw the first exception raised by body, once all threads have stopped
+ */
+void runLevels(const std::vector<std::vector<size_t>> &levels,
+               unsigned nbThreads, const std::function<void(size_t)> &body);
+
+}  // namespace btypeParallel
+
+#endif  // BTYPE_PARALLEL_H
@@ -0,0 +1,148 @@
+/* @file btype_rich_types_info.cpp
+   @brief Creation of the types described by RichTypesInfo records.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_rich_types_info.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include "btype_parallel.h"
+
+namespace {
+
+using richTypesInfo::Record;
+
+std::shared_ptr<BType> make(const Record &record,
+                            const std::vector<std::shared_ptr<BType>> &types) {
+  switch (record.kind) {
+    case Record::Kind::BOOL:
+      return BTypeFactory::Boolean();
+    case Record::Kind::INTEGER:
+      return BTypeFactory::Integer();
+    case Record::Kind::REAL:
+      return BTypeFactory::Real();
+    case Record::Kind::FLOAT:
+      return BTypeFactory::Float();
+    case Record::Kind::STRING:
+      return BTypeFactory::String();
+    case Record::Kind::PowerSet:
+      return BTypeFactory::PowerSet(types[record.args[0]]);
+    case Record::Kind::CartesianProduct:
+      return BTypeFactory::Product(types[record.args[0]],
+                                   types[record.args[1]]);
+    case Record::Kind::AbstractSet:
+      return BTypeFactory::AbstractSet(record.name);
+    case Record::Kind::EnumeratedSet:
+      return BTypeFactory::EnumeratedSet(record.name, record.labels);
+    case Record::Kind::StructType: {
+      std::vector<std::pair<std::string, std::shared_ptr<BType>>> fields;
+      fields.reserve(record.args.size());
+      for (size_t i = 0; i < record.args.size(); ++i)
+        fields.emplace_back(record.labels[i], types[record.args[i]]);
+      return BTypeFactory::Struct(fields);
+    }
+  }
+  // Should never reach here
+  return nullptr;
+}
+
+// Calls visit on each record id, after having called it on the ids of its
+// arguments. Uses an explicit stack: chains of references may be very long.
+template <typename F>
+void postOrder(const std::vector<Record> &records, F &&visit) {
+  enum : uint8_t { TODO, ACTIVE, DONE };
+  std::vector<uint8_t> state(records.size(), TODO);
+  std::vector<std::pair<size_t, size_t>> stack;  // id, next argument
+  for (size_t root = 0; root < records.size(); ++root) {
+    if (state[root] != TODO) continue;
+    state[root] = ACTIVE;
+    stack.emplace_back(root, 0);
+    while (!stack.empty()) {
+      auto &[id, next] = stack.back();
+      const auto &args = records[id].args;
+      if (next < args.size()) {
+        const size_t arg = args[next++];
+        if (arg >= records.size()) {
+          throw BTypeFactory::Exception("Invalid reference to id " +
+                                        std::to_string(arg));
+        }
+        if (state[arg] == ACTIVE) {
+          throw BTypeFactory::Exception("Cyclic reference to id " +
+                                        std::to_string(arg));
+        }
+        if (state[arg] == TODO) {
+          state[arg] = ACTIVE;
+          stack.emplace_back(arg, 0);
+        }
+        continue;
+      }
+      state[id] = DONE;
+      visit(id);
+      stack.pop_back();
+    }
+  }
+}
+
+}  // namespace
+
+namespace richTypesInfo {
+
+std::vector<std::shared_ptr<BType>> resolve(const std::vector<Record> &records,
+                                            unsigned nbThreads) {
+  std::vector<std::shared_ptr<BType>> types(records.size());
+  if (nbThreads == 0) nbThreads = btypeParallel::defaultThreads();
+  if (nbThreads == 1) {
+    postOrder(records,
+              [&](size_t id) { types[id] = make(records[id], types); });
+    return types;
+  }
+
+  // The factory keeps a single EnumeratedSet per name: the one created first.
+  // With one thread, it is the first one in post-order. So that the types
+  // do not depend on the number of threads, the later records with the same
+  // name get the type of that first one, one level after it.
+  std::unordered_map<std::string_view, size_t> firstEnumeratedSet;
+  std::vector<size_t> sameAs(records.size(), SIZE_MAX);
+  std::vector<size_t> level(records.size(), 0);
+  std::vector<std::vector<size_t>> levels;
+  postOrder(records, [&](size_t id) {
+    size_t l = 0;
+    const Record &record = records[id];
+    if (record.kind == Record::Kind::EnumeratedSet) {
+      auto [it, inserted] = firstEnumeratedSet.try_emplace(record.name, id);
+      if (!inserted) {
+        sameAs[id] = it->second;
+        l = level[it->second] + 1;
+      }
+    }
+    for (size_t arg : record.args) l = std::max(l, level[arg] + 1);
+    level[id] = l;
+    if (levels.size() <= l) levels.resize(l + 1);
+    levels[l].push_back(id);
+  });
+  btypeParallel::runLevels(levels, nbThreads, [&](size_t id) {
+    types[id] = sameAs[id] == SIZE_MAX ? make(records[id], types)
+                                       : types[sameAs[id]];
+  });
+  return types;
+}
+
+}  // namespace richTypesInfo
@@ -0,0 +1,85 @@
+/* @file btype_rich_types_info.h
+   @brief Internal representation of the entries of a RichTypesInfo document.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_RICH_TYPES_INFO_H
+#define BTYPE_RICH_TYPES_INFO_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "btype.h"
+
+namespace richTypesInfo {
+
+/**
+ * @brief The content of a RichType element, with references to other
+ * RichType elements given by their id.
+ */
+struct Record {
+  /** @brief The type definition elements of RichTypesInfo.xsd */
+  enum class Kind {
+    BOOL,
+    INTEGER,
+    REAL,
+    FLOAT,
+    STRING,
+    PowerSet,
+    CartesianProduct,
+    AbstractSet,
+    EnumeratedSet,
+    StructType
+  };
+  Kind kind = Kind::INTEGER;
+  /** @brief Name of an AbstractSet or EnumeratedSet */
+  std::string name;
+  /** @brief Values of an EnumeratedSet, or field names of a StructType */
+  std::vector<std::string> labels;
+  /** @brief Ids of the arguments (PowerSet, CartesianProduct) or of the field
+   * types (StructType) */
+  std::vector<size_t> args;
+};
+
+/**
+ * @brief Reads the records of a RichTypesInfo document, without building a
+ * DOM.
+ * @param xml the text of the document
+ * @return the records, indexed by RichType id
+ * @throw BTypeFactory::Exception if the document is not well-formed XML or
+ * does not follow RichTypesInfo.xsd
+ */
+std::vector<Record> scan(std::string_view xml);
+
+/**
+ * @brief Creates the types described by a sequence of records.
+ * @param records the records, indexed by RichType id
+ * @param nbThreads number of threads. With 1 thread, types are created in id
+ * order (each after its arguments). With more threads, the records are grouped
+ * in levels of the dependency graph, and the types of each level are created
+ * concurrently; the resulting types are the same, but their order in the
+ * BTypeFactory table may differ. 0 means one thread per hardware thread.
+ * @return the types, indexed by RichType id
+ * @throw BTypeFactory::Exception if a reference is out of range or cyclic
+ */
+std::vector<std::shared_ptr<BType>> resolve(const std::vector<Record> &records,
+                                            unsigned nbThreads);
+
+}  // namespace richTypesInfo
+
+#endif  // BTYPE_RICH_TYPES_INFO_H
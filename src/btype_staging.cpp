@@ -0,0 +1,168 @@
+/* @file btype_staging.cpp
+   @brief Implementation file for the BTypeStaging class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_staging.h"
+
+#include <cstdint>
+#include <unordered_set>
+
+namespace {
+// Replaces a staged type that has already been committed by its published
+// counterpart, so that further lookups may hit the factory table.
+std::shared_ptr<BType> resolve(
+    const std::unordered_map<const BType *, std::shared_ptr<BType>> &committed,
+    const std::shared_ptr<BType> &type) {
+  if (!BTypeStaging::isStaged(*type)) return type;
+  auto it = committed.find(type.get());
+  return it == committed.end() ? type : it->second;
+}
+}  // namespace
+
+std::shared_ptr<BType> BTypeStaging::stage(std::shared_ptr<BType> type) {
+  m_staged.push_back(type);
+  return type;
+}
+
+std::shared_ptr<BType> BTypeStaging::Product(
+    const std::shared_ptr<BType> &lhs, const std::shared_ptr<BType> &rhs) {
+  auto l = resolve(m_committed, lhs);
+  auto r = resolve(m_committed, rhs);
+  if (!isStaged(*l) && !isStaged(*r)) {
+    auto found = BTypeFactory::findProduct(l, r);
+    if (found) return found;
+  }
+  auto &slot = m_productTypes[std::make_pair(l.get(), r.get())];
+  if (!slot) slot = stage(BType::make<BType::ProductType>(l, r));
+  return slot;
+}
+
+std::shared_ptr<BType> BTypeStaging::PowerSet(
+    const std::shared_ptr<BType> &content) {
+  auto c = resolve(m_committed, content);
+  if (!isStaged(*c)) {
+    auto found = BTypeFactory::findPowerSet(c);
+    if (found) return found;
+  }
+  auto &slot = m_powerTypes[c.get()];
+  if (!slot) slot = stage(BType::make<BType::PowerType>(c));
+  return slot;
+}
+
+std::shared_ptr<BType> BTypeStaging::AbstractSet(const std::string &name) {
+  auto found = BTypeFactory::findAbstractSet(name);
+  if (found) return found;
+  auto &slot = m_abstractSets[name];
+  if (!slot) slot = stage(BType::make<BType::AbstractSet>(name));
+  return slot;
+}
+
+std::shared_ptr<BType> BTypeStaging::EnumeratedSet(
+    const std::string &name, const std::vector<std::string> &values) {
+  auto found = BTypeFactory::findEnumeratedSet(name);
+  if (found) return found;
+  auto &slot = m_enumeratedSets[name];
+  if (!slot)
+    slot = stage(
+        BType::make<BType::EnumeratedSet>(std::make_pair(name, values)));
+  return slot;
+}
+
+std::shared_ptr<BType> BTypeStaging::Struct(
+    const std::vector<std::pair<std::string, std::shared_ptr<BType>>>
+        &fields) {
+  auto sortedFields = BType::StructType::sort(fields);
+  bool published = true;
+  for (auto &field : sortedFields) {
+    field.second = resolve(m_committed, field.second);
+    published = published && !isStaged(*field.second);
+  }
+  if (published) {
+    auto found = BTypeFactory::findStruct(sortedFields);
+    if (found) return found;
+  }
+  std::string keyString;
+  for (const auto &field : sortedFields) {
+    keyString.append(field.first);
+    keyString.push_back(';');
+    keyString.append(std::to_string(
+        reinterpret_cast<std::uintptr_t>(field.second.get())));
+    keyString.push_back(';');
+  }
+  auto &slot = m_structTypes[keyString];
+  if (!slot) slot = stage(BType::make<BType::StructType>(sortedFields));
+  return slot;
+}
+
+std::shared_ptr<BType> BTypeStaging::commit(
+    const std::shared_ptr<BType> &type) {
+  if (!isStaged(*type)) return type;
+  return commit(std::vector<std::shared_ptr<BType>>{type}).front();
+}
+
+// The staged types reachable from types are listed sub-types first, without
+// recursion, and published in a single batch. Staged types that were already
+// committed are listed again, since other staged types may refer to them:
+// the factory finds them in the table.
+std::vector<std::shared_ptr<BType>> BTypeStaging::commit(
+    const std::vector<std::shared_ptr<BType>> &types) {
+  std::vector<std::shared_ptr<BType>> staged;
+  std::unordered_set<const BType *> visited;
+  // A type, and whether its sub-types are already listed
+  std::vector<std::pair<std::shared_ptr<BType>, bool>> stack;
+  std::vector<std::shared_ptr<BType>> children;
+  for (auto it = types.rbegin(); it != types.rend(); ++it)
+    stack.emplace_back(*it, false);
+  while (!stack.empty()) {
+    auto [type, expanded] = std::move(stack.back());
+    stack.pop_back();
+    if (expanded) {
+      staged.push_back(std::move(type));
+      continue;
+    }
+    if (!isStaged(*type) || !visited.insert(type.get()).second) continue;
+    stack.emplace_back(type, true);
+    children.clear();
+    type->forEachChild([&](const std::shared_ptr<BType> &child) {
+      children.push_back(child);
+    });
+    for (auto it = children.rbegin(); it != children.rend(); ++it)
+      stack.emplace_back(*it, false);
+  }
+
+  const auto published = BTypeFactory::publishStaged(staged);
+  for (size_t i = 0; i < staged.size(); ++i)
+    m_committed.emplace(staged[i].get(), published[i]);
+
+  std::vector<std::shared_ptr<BType>> result;
+  result.reserve(types.size());
+  for (const auto &type : types)
+    result.push_back(isStaged(*type) ? m_committed.at(type.get()) : type);
+  return result;
+}
+
+void BTypeStaging::clear() {
+  m_productTypes.clear();
+  m_powerTypes.clear();
+  m_abstractSets.clear();
+  m_enumeratedSets.clear();
+  m_structTypes.clear();
+  m_committed.clear();
+  // Staged types are listed after their sub-types: they are released from
+  // the last, so that releasing a long chain does not recurse once per link
+  while (!m_staged.empty()) m_staged.pop_back();
+}
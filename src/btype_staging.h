@@ -0,0 +1,129 @@
+/* @file btype_staging.h
+   @brief Header file for the BTypeStaging class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_STAGING_H
+#define BTYPE_STAGING_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "btype.h"
+
+/**
+ * @brief Builds candidate types privately, before publishing some of them in
+ * the BTypeFactory table.
+ *
+ * A staging builder has the same constructors as BTypeFactory. A type that
+ * already exists in the table is returned as is; any other type is
+ * hash-consed in the builder only: it is said to be staged. Staged types have
+ * no index (BType::index() returns SIZE_MAX) and are not visible to other
+ * builders nor to the factory.
+ *
+ * commit() publishes staged types, with their sub-types, in the table and
+ * returns the published types. A commit is a single batch: the factory
+ * tables are locked once for all its types, and the listeners receive them
+ * in one delivery. Staged types that are not committed are discarded with
+ * the builder, or by clear().
+ *
+ * Staged types are not types of the table: passing one to a BTypeFactory
+ * constructor throws BTypeFactory::Exception; it must be committed first.
+ *
+ * A builder is meant to be used by a single thread and performs no
+ * synchronization of its own. Types staged in a builder must not be passed to
+ * another builder.
+ *
+ * Basic types are singletons and are always taken from the factory.
+ */
+class BTypeStaging {
+ public:
+  BTypeStaging() = default;
+  ~BTypeStaging() { clear(); }
+  BTypeStaging(const BTypeStaging &) = delete;
+  BTypeStaging &operator=(const BTypeStaging &) = delete;
+
+  // Basic types
+  std::shared_ptr<BType> Integer() { return BTypeFactory::Integer(); }
+  std::shared_ptr<BType> Boolean() { return BTypeFactory::Boolean(); }
+  std::shared_ptr<BType> Float() { return BTypeFactory::Float(); }
+  std::shared_ptr<BType> Real() { return BTypeFactory::Real(); }
+  std::shared_ptr<BType> String() { return BTypeFactory::String(); }
+
+  // Complex type constructors
+  std::shared_ptr<BType> Product(const std::shared_ptr<BType> &lhs,
+                                 const std::shared_ptr<BType> &rhs);
+  std::shared_ptr<BType> PowerSet(const std::shared_ptr<BType> &content);
+  std::shared_ptr<BType> AbstractSet(const std::string &name);
+  std::shared_ptr<BType> EnumeratedSet(const std::string &name,
+                                       const std::vector<std::string> &values);
+  std::shared_ptr<BType> Struct(
+      const std::vector<std::pair<std::string, std::shared_ptr<BType>>>
+          &fields);
+
+  /**
+   * @brief Tells if a type is staged, i.e., is not in the factory table.
+   */
+  static bool isStaged(const BType &type) { return type.index() == SIZE_MAX; }
+
+  /**
+   * @brief Publishes a type, and its staged sub-types, in the factory table.
+   * @param type a type of the table, or a type staged in this builder
+   * @return the type of the table that is equal to the given type
+   */
+  std::shared_ptr<BType> commit(const std::shared_ptr<BType> &type);
+
+  /**
+   * @brief Publishes several types in the factory table.
+   * @param types types of the table, or types staged in this builder
+   * @return the published types, in the same order
+   */
+  std::vector<std::shared_ptr<BType>> commit(
+      const std::vector<std::shared_ptr<BType>> &types);
+
+  /** @brief Gets the number of types currently staged. */
+  size_t size() const { return m_staged.size(); }
+
+  /** @brief Discards all the staged types. */
+  void clear();
+
+ private:
+  struct PairHash {
+    size_t operator()(const std::pair<const BType *, const BType *> &p) const {
+      const size_t h = std::hash<const BType *>{}(p.first);
+      return h ^ (std::hash<const BType *>{}(p.second) + 0x9e3779b9 +
+                  (h << 6) + (h >> 2));
+    }
+  };
+
+  std::shared_ptr<BType> stage(std::shared_ptr<BType> type);
+
+  std::unordered_map<std::pair<const BType *, const BType *>,
+                     std::shared_ptr<BType>, PairHash>
+      m_productTypes;
+  std::unordered_map<const BType *, std::shared_ptr<BType>> m_powerTypes;
+  std::unordered_map<std::string, std::shared_ptr<BType>> m_abstractSets;
+  std::unordered_map<std::string, std::shared_ptr<BType>> m_enumeratedSets;
+  std::unordered_map<std::string, std::shared_ptr<BType>>
+      m_structTypes;  // indexed by field names and field type addresses
+  std::vector<std::shared_ptr<BType>> m_staged;
+  std::unordered_map<const BType *, std::shared_ptr<BType>> m_committed;
+};
+
+#endif  // BTYPE_STAGING_H
@@ -0,0 +1,143 @@
+/* @file btype_subscription.cpp
+   @brief Implementation file for the BTypeSubscription and BTypeListener
+   classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_subscription.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+struct BTypeListener::State {
+  Callback callback;
+  // Held while the callback runs, so that the destructor of the listener
+  // waits for it
+  std::mutex mutex;
+  bool active = true;
+  size_t next;
+};
+
+struct BTypeListener::Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<State>> listeners;
+  // Set by deliver() while a thread delivers
+  bool delivering = false;
+  // Set when types may have been published, or listeners added, since the
+  // delivering thread last read the table size
+  bool pending = false;
+  // Smallest first index of the listeners added since then
+  size_t added = SIZE_MAX;
+  // Number of types delivered to all listeners
+  std::atomic<size_t> delivered{0};
+  std::atomic<size_t> nbListeners{0};
+};
+
+BTypeListener::Registry &BTypeListener::registry() {
+  static Registry instance;
+  return instance;
+}
+
+BTypeSubscription::BTypeSubscription() : m_next{BTypeFactory::size()} {}
+
+size_t BTypeSubscription::poll(std::vector<std::shared_ptr<BType>> &batch,
+                               size_t max) {
+  batch.clear();
+  const size_t published = BTypeFactory::published();
+  if (published <= m_next) return 0;
+  const size_t last = m_next + std::min(max, published - m_next);
+  BTypeFactory::copy(m_next, last, batch);
+  m_next = last;
+  return batch.size();
+}
+
+BTypeListener::BTypeListener(Callback callback)
+    : BTypeListener(std::move(callback), BTypeFactory::size()) {}
+
+BTypeListener::BTypeListener(Callback callback, size_t first)
+    : m_state{std::make_shared<State>()} {
+  m_state->callback = std::move(callback);
+  m_state->next = first;
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.listeners.push_back(m_state);
+  ++r.nbListeners;
+  r.pending = true;
+  r.added = std::min(r.added, first);
+  if (first < r.delivered.load()) r.delivered.store(first);
+}
+
+BTypeListener::~BTypeListener() {
+  {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    auto &listeners = registry().listeners;
+    listeners.erase(std::find(listeners.begin(), listeners.end(), m_state));
+    --registry().nbListeners;
+  }
+  // Waits for a delivery in progress
+  std::lock_guard<std::mutex> lock(m_state->mutex);
+  m_state->active = false;
+}
+
+void BTypeListener::deliver() {
+  Registry &r = registry();
+  if (r.nbListeners.load() == 0 ||
+      BTypeFactory::published() <= r.delivered.load())
+    return;
+  std::unique_lock<std::mutex> lock(r.mutex);
+  r.pending = true;
+  if (r.delivering) return;
+  r.delivering = true;
+  std::vector<std::shared_ptr<State>> listeners;
+  std::vector<std::shared_ptr<BType>> batch;
+  try {
+    while (r.pending) {
+      r.pending = false;
+      r.added = SIZE_MAX;
+      listeners = r.listeners;
+      lock.unlock();
+      const size_t published = BTypeFactory::published();
+      // Smallest first index of the batches to deliver again
+      size_t retry = SIZE_MAX;
+      for (const auto &listener : listeners) {
+        std::lock_guard<std::mutex> listenerLock(listener->mutex);
+        if (!listener->active || listener->next >= published) continue;
+        const size_t first = listener->next;
+        batch.clear();
+        BTypeFactory::copy(first, published, batch);
+        listener->next = published;
+        try {
+          listener->callback(batch);
+        } catch (...) {
+          // The types were created: the error is not the creator's. The batch
+          // is delivered again, to this listener only, after the next creation.
+          listener->next = first;
+          retry = std::min(retry, first);
+        }
+      }
+      lock.lock();
+      r.delivered.store(std::min({published, r.added, retry}));
+    }
+  } catch (...) {
+    // An allocation failed: the next call must still be able to deliver
+    if (!lock.owns_lock()) lock.lock();
+    r.delivering = false;
+    throw;
+  }
+  r.delivering = false;
+}
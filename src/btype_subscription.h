@@ -0,0 +1,131 @@
+/* @file btype_subscription.h
+   @brief Header file for the BTypeSubscription and BTypeListener classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_SUBSCRIPTION_H
+#define BTYPE_SUBSCRIPTION_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "btype.h"
+
+/**
+ * @brief Cursor over the types published by the BTypeFactory, in index
+ * order.
+ *
+ * A type is published when it is added to the table, after its sub-types.
+ * Each poll() returns the types published since the previous one, so that a
+ * consumer only works on new types. When there is none, poll() takes no lock.
+ *
+ * A subscription is used by a single consumer thread; consumers have their
+ * own subscriptions.
+ *
+ * @code
+ * BTypeSubscription subscription(0);  // from the first type of the table
+ * std::vector<std::shared_ptr<BType>> batch;
+ * while (subscription.poll(batch) != 0)
+ *   for (const auto &type : batch) declare(type);
+ * @endcode
+ */
+class BTypeSubscription {
+ public:
+  /** @brief Subscribes to the types created from now on. */
+  BTypeSubscription();
+  /**
+   * @brief Subscribes to the types from a given index on.
+   * @param first the index of the first type to deliver; 0 delivers the
+   * whole table
+   */
+  explicit BTypeSubscription(size_t first) : m_next{first} {}
+
+  /**
+   * @brief Gets the types published since the previous call.
+   * @param batch receives the types, in index order; its previous content is
+   * removed
+   * @param max the maximal number of types
+   * @return the number of types
+   */
+  size_t poll(std::vector<std::shared_ptr<BType>> &batch,
+              size_t max = SIZE_MAX);
+
+  /** @brief Gets the index of the next type to deliver. */
+  size_t next() const { return m_next; }
+
+ private:
+  size_t m_next;
+};
+
+/**
+ * @brief Callback registration for the types published by the BTypeFactory.
+ *
+ * The callback is called with batches of new types, in index order, from the
+ * threads that create types: after a function of the factory has created
+ * types, and before it returns, the types are delivered to all listeners. A
+ * single thread delivers at a time; types created meanwhile by other threads
+ * are delivered by that thread. The callback may create types, which are
+ * delivered in a later batch.
+ *
+ * If the callback throws, the exception is dropped, so that it does not
+ * reach the function of the factory, which has created its types; the same
+ * types, with the newer ones, are delivered again to that listener after the
+ * next creation. The other listeners are not affected. If the delivery
+ * itself fails, for instance on an allocation failure, the exception reaches
+ * the function of the factory, and the types not delivered are delivered
+ * after the next creation.
+ *
+ * The callback is no longer called once the listener is destroyed. A
+ * listener must not be destroyed by its own callback.
+ *
+ * @code
+ * BTypeListener listener([&](const auto &batch) { index.add(batch); });
+ * @endcode
+ */
+class BTypeListener {
+ public:
+  using Callback =
+      std::function<void(const std::vector<std::shared_ptr<BType>> &)>;
+
+  /** @brief Registers a callback for the types created from now on. */
+  explicit BTypeListener(Callback callback);
+  /**
+   * @brief Registers a callback for the types from a given index on. The
+   * types already in the table are delivered by the next creation.
+   */
+  BTypeListener(Callback callback, size_t first);
+  BTypeListener(const BTypeListener &) = delete;
+  BTypeListener &operator=(const BTypeListener &) = delete;
+  ~BTypeListener();
+
+  /**
+   * @brief Delivers the published types to the listeners. Called by the
+   * factory after each request that created types, but not after lookups of
+   * existing types; takes no lock when all types were delivered.
+   */
+  static void deliver();
+
+ private:
+  struct State;
+  struct Registry;
+  static Registry &registry();
+
+  std::shared_ptr<State> m_state;
+};
+
+#endif  // BTYPE_SUBSCRIPTION_H
@@ -0,0 +1,584 @@
+/* @file btype_symbolic_set.cpp
+   @brief Implementation file for the BddManager, BTypeBddLayout and
+   BSymbolicSet classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_symbolic_set.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "btype_index_memo.h"
+
+namespace {
+
+uint32_t bitsFor(uint64_t cardinality) {
+  uint32_t width = 0;
+  while (width < 64 && (uint64_t(1) << width) < cardinality) ++width;
+  return width;
+}
+
+uint64_t hashNode(uint32_t variable, uint32_t low, uint32_t high) {
+  uint64_t h = (uint64_t(variable) << 32) ^ low;
+  h = (h ^ (h >> 31)) * 0x9e3779b97f4a7c15ULL;
+  h ^= uint64_t(high) * 0xc4ceb9fe1a85ec53ULL;
+  return h ^ (h >> 29);
+}
+
+uint64_t hashOperation(uint32_t op, uint32_t f, uint32_t g, uint32_t h) {
+  return hashNode(op, f, g) ^ uint64_t(h) * 0x9e3779b97f4a7c15ULL;
+}
+
+}  // namespace
+
+BTypeBddLayout::BTypeBddLayout(const std::shared_ptr<BType> &type)
+    : m_type{type}, m_cardinality{1} {
+  switch (type->getKind()) {
+    case BType::Kind::BOOLEAN:
+    case BType::Kind::EnumeratedSet: {
+      const uint64_t cardinality =
+          type->getKind() == BType::Kind::BOOLEAN
+              ? 2
+              : type->asEnumeratedSetType()->getValues().size();
+      const uint32_t width = bitsFor(cardinality);
+      m_fields.push_back(Field{0, width, cardinality});
+      m_variables.resize(width);
+      std::iota(m_variables.begin(), m_variables.end(), 0);
+      m_cardinality = cardinality;
+      return;
+    }
+    case BType::Kind::ProductType:
+    case BType::Kind::Struct:
+      break;
+    default:
+      throw BTypeFactory::Exception("Type without finite encoding");
+  }
+
+  // Products interleave the variables of their operands: variable v of the
+  // left operand is sorted as 2v, variable v of the right one as 2v + 1.
+  // Structs place the variables of their fields one after the other.
+  const bool interleaved = type->getKind() == BType::Kind::ProductType;
+  std::vector<uint64_t> keys;
+  uint64_t offset = 0;
+  unsigned position = 0;
+  bool overflow = false;
+  type->forEachChild([&](const std::shared_ptr<BType> &child) {
+    const auto layout = of(child);
+    const auto first = static_cast<uint32_t>(keys.size());
+    for (uint32_t bit = 0; bit < layout->width(); ++bit) {
+      const uint64_t variable = layout->variable(bit);
+      keys.push_back(interleaved ? 2 * variable + position
+                                 : offset + variable);
+    }
+    for (const auto &field : layout->fields())
+      m_fields.push_back(
+          Field{first + field.first, field.width, field.cardinality});
+    offset += layout->width();
+    ++position;
+    const uint64_t cardinality = layout->cardinality();
+    if (overflow || cardinality == 0 ||
+        m_cardinality > UINT64_MAX / cardinality)
+      overflow = true;
+    else
+      m_cardinality *= cardinality;
+  });
+  if (overflow) m_cardinality = 0;
+
+  // Variables are the ranks of the keys
+  std::vector<uint32_t> order(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+  m_variables.resize(keys.size());
+  for (uint32_t v = 0; v < order.size(); ++v) m_variables[order[v]] = v;
+}
+
+std::shared_ptr<const BTypeBddLayout> BTypeBddLayout::of(
+    const std::shared_ptr<BType> &type) {
+  static BTypeIndexMemo<std::shared_ptr<const BTypeBddLayout>> memo;
+  return memo.get(
+      *type, [&] { return std::make_shared<const BTypeBddLayout>(type); });
+}
+
+std::vector<uint64_t> BTypeBddLayout::ordinals(uint64_t rank) const {
+  if (m_cardinality == 0 || rank >= m_cardinality)
+    throw BTypeFactory::Exception("Rank out of range");
+  std::vector<uint64_t> result(m_fields.size());
+  for (size_t i = m_fields.size(); i-- > 0;) {
+    result[i] = rank % m_fields[i].cardinality;
+    rank /= m_fields[i].cardinality;
+  }
+  return result;
+}
+
+uint64_t BTypeBddLayout::rank(const std::vector<uint64_t> &ordinals) const {
+  uint64_t result = 0;
+  for (size_t i = 0; i < m_fields.size(); ++i)
+    result = result * m_fields[i].cardinality + ordinals[i];
+  return result;
+}
+
+std::vector<uint64_t> BTypeBddLayout::ordinals(const BValue &value) const {
+  if (&value.type() != m_type.get())
+    throw BTypeFactory::Exception("Value does not have the expected type");
+  std::vector<uint64_t> result;
+  result.reserve(m_fields.size());
+  encode(value, result);
+  return result;
+}
+
+void BTypeBddLayout::encode(const BValue &value,
+                            std::vector<uint64_t> &ordinals) const {
+  switch (value.type().getKind()) {
+    case BType::Kind::BOOLEAN:
+      ordinals.push_back(value.asBoolean() ? 1 : 0);
+      break;
+    case BType::Kind::EnumeratedSet:
+      ordinals.push_back(value.ordinal());
+      break;
+    case BType::Kind::ProductType:
+      encode(value.first(), ordinals);
+      encode(value.second(), ordinals);
+      break;
+    default:
+      for (size_t i = 0; i < value.size(); ++i)
+        encode(value.element(i), ordinals);
+      break;
+  }
+}
+
+BddManager::BddManager()
+    : m_nodes{{UINT32_MAX, False, False}, {UINT32_MAX, True, True}},
+      m_unique(1 << 12, False),
+      // Terminal arguments are not cached: the initial entries never match
+      m_cache(1 << 12, CacheEntry{Op::And, True, True, True, True}) {}
+
+// Doubles the unique table and the cache
+void BddManager::grow() {
+  m_unique.assign(m_unique.size() * 2, False);
+  const size_t mask = m_unique.size() - 1;
+  for (Node f = 2; f < m_nodes.size(); ++f) {
+    const NodeData &node = m_nodes[f];
+    size_t slot = hashNode(node.variable, node.low, node.high) & mask;
+    while (m_unique[slot] != False) slot = (slot + 1) & mask;
+    m_unique[slot] = f;
+  }
+  m_cache.assign(m_unique.size(), CacheEntry{Op::And, True, True, True, True});
+}
+
+BddManager::Node BddManager::make(uint32_t variable, Node low, Node high) {
+  if (low == high) return low;
+  const size_t mask = m_unique.size() - 1;
+  size_t slot = hashNode(variable, low, high) & mask;
+  for (; m_unique[slot] != False; slot = (slot + 1) & mask) {
+    const NodeData &node = m_nodes[m_unique[slot]];
+    if (node.variable == variable && node.low == low && node.high == high)
+      return m_unique[slot];
+  }
+  if (m_nodes.size() >= UINT32_MAX)
+    throw BTypeFactory::Exception("Too many BDD nodes");
+  const auto f = static_cast<Node>(m_nodes.size());
+  m_nodes.push_back(NodeData{variable, low, high});
+  m_unique[slot] = f;
+  if (2 * m_nodes.size() > m_unique.size()) grow();
+  return f;
+}
+
+BddManager::Node BddManager::apply(Op op, Node f, Node g) {
+  switch (op) {
+    case Op::And:
+      if (f == False || g == False) return False;
+      if (f == True || f == g) return g;
+      if (g == True) return f;
+      if (f > g) std::swap(f, g);
+      break;
+    case Op::Or:
+      if (f == True || g == True) return True;
+      if (f == False || f == g) return g;
+      if (g == False) return f;
+      if (f > g) std::swap(f, g);
+      break;
+    default:
+      if (f == False || g == True || f == g) return False;
+      if (g == False) return f;
+      break;
+  }
+  const uint64_t hash = hashOperation(static_cast<uint32_t>(op), f, g, False);
+  {
+    const CacheEntry &entry = m_cache[hash & (m_cache.size() - 1)];
+    if (entry.op == op && entry.f == f && entry.g == g) return entry.result;
+  }
+
+  const uint32_t v = std::min(variable(f), variable(g));
+  const NodeData nf = m_nodes[f];
+  const NodeData ng = m_nodes[g];
+  const Node f0 = nf.variable == v ? nf.low : f;
+  const Node f1 = nf.variable == v ? nf.high : f;
+  const Node g0 = ng.variable == v ? ng.low : g;
+  const Node g1 = ng.variable == v ? ng.high : g;
+  const Node low = apply(op, f0, g0);
+  const Node high = apply(op, f1, g1);
+  const Node result = make(v, low, high);
+  // make() may have resized the cache
+  m_cache[hash & (m_cache.size() - 1)] = CacheEntry{op, f, g, False, result};
+  return result;
+}
+
+// Computes (exists cube . f and g), cube being a conjunction of variables
+BddManager::Node BddManager::andExists(Node f, Node g, Node cube) {
+  if (f == False || g == False) return False;
+  if (f == True && g == True) return True;
+  const uint32_t v = std::min(variable(f), variable(g));
+  while (cube != True && variable(cube) < v) cube = m_nodes[cube].high;
+  if (cube == True) return apply(Op::And, f, g);
+  if (f > g) std::swap(f, g);
+  const uint64_t hash =
+      hashOperation(static_cast<uint32_t>(Op::AndExists), f, g, cube);
+  {
+    const CacheEntry &entry = m_cache[hash & (m_cache.size() - 1)];
+    if (entry.op == Op::AndExists && entry.f == f && entry.g == g &&
+        entry.h == cube)
+      return entry.result;
+  }
+
+  const NodeData nf = m_nodes[f];
+  const NodeData ng = m_nodes[g];
+  const Node f0 = nf.variable == v ? nf.low : f;
+  const Node f1 = nf.variable == v ? nf.high : f;
+  const Node g0 = ng.variable == v ? ng.low : g;
+  const Node g1 = ng.variable == v ? ng.high : g;
+  Node result;
+  if (variable(cube) == v) {
+    const Node rest = m_nodes[cube].high;
+    const Node low = andExists(f0, g0, rest);
+    result = low == True ? True : apply(Op::Or, low, andExists(f1, g1, rest));
+  } else {
+    const Node low = andExists(f0, g0, cube);
+    result = make(v, low, andExists(f1, g1, cube));
+  }
+  m_cache[hash & (m_cache.size() - 1)] =
+      CacheEntry{Op::AndExists, f, g, cube, result};
+  return result;
+}
+
+BddManager::Node BddManager::cofactor(
+    Node f, uint32_t variable, bool value,
+    std::unordered_map<Node, Node> &restricted) {
+  // Terminals have the largest variable
+  const NodeData node = m_nodes[f];
+  if (node.variable > variable) return f;
+  if (node.variable == variable) return value ? node.high : node.low;
+  auto it = restricted.find(f);
+  if (it != restricted.end()) return it->second;
+  const Node low = cofactor(node.low, variable, value, restricted);
+  const Node high = cofactor(node.high, variable, value, restricted);
+  const Node result = make(node.variable, low, high);
+  restricted.emplace(f, result);
+  return result;
+}
+
+BddManager::Node BddManager::rename(Node f, const std::vector<uint32_t> &map,
+                                    std::unordered_map<Node, Node> &renamed) {
+  if (f == False || f == True) return f;
+  auto it = renamed.find(f);
+  if (it != renamed.end()) return it->second;
+  const NodeData node = m_nodes[f];
+  const Node low = rename(node.low, map, renamed);
+  const Node high = rename(node.high, map, renamed);
+  const Node result = make(map[node.variable], low, high);
+  renamed.emplace(f, result);
+  return result;
+}
+
+// Builds the comparison from the least significant bit: r is the set of
+// suffixes less than the suffix of bound
+BddManager::Node BddManager::lessThan(const BTypeBddLayout &layout,
+                                      const BTypeBddLayout::Field &field,
+                                      uint64_t bound) {
+  if (field.width < 64 && bound >= (uint64_t(1) << field.width)) return True;
+  Node r = False;
+  for (uint32_t i = field.width; i-- > 0;) {
+    const uint32_t v = layout.variable(field.first + i);
+    const bool bit = (bound >> (field.width - 1 - i)) & 1;
+    r = bit ? make(v, True, r) : make(v, r, False);
+  }
+  return r;
+}
+
+BddManager::Node BddManager::domain(
+    const std::shared_ptr<const BTypeBddLayout> &layout) {
+  auto it = m_domains.find(layout.get());
+  if (it != m_domains.end()) return it->second.second;
+  Node result = True;
+  for (const auto &field : layout->fields())
+    result =
+        apply(Op::And, result, lessThan(*layout, field, field.cardinality));
+  m_domains.emplace(layout.get(), std::make_pair(layout, result));
+  return result;
+}
+
+BddManager::Node BddManager::code(const BTypeBddLayout &layout,
+                                  const std::vector<uint64_t> &ordinals) {
+  // Literals sorted by decreasing variable, to build the BDD bottom-up
+  std::vector<std::pair<uint32_t, bool>> literals;
+  for (size_t i = 0; i < ordinals.size(); ++i) {
+    const auto &field = layout.fields()[i];
+    for (uint32_t b = 0; b < field.width; ++b) {
+      literals.emplace_back(layout.variable(field.first + b),
+                            (ordinals[i] >> (field.width - 1 - b)) & 1);
+    }
+  }
+  std::sort(literals.rbegin(), literals.rend());
+  Node r = True;
+  for (const auto &literal : literals)
+    r = literal.second ? make(literal.first, False, r)
+                       : make(literal.first, r, False);
+  return r;
+}
+
+BddManager::Node BddManager::cube(const std::vector<uint32_t> &variables) {
+  std::vector<uint32_t> sorted = variables;
+  std::sort(sorted.rbegin(), sorted.rend());
+  Node r = True;
+  for (uint32_t v : sorted) r = make(v, False, r);
+  return r;
+}
+
+double BddManager::count(Node f, uint32_t nbVariables,
+                         std::unordered_map<Node, double> &counted) const {
+  if (f == False) return 0;
+  if (f == True) return 1;
+  auto it = counted.find(f);
+  if (it != counted.end()) return it->second;
+  const NodeData &node = m_nodes[f];
+  auto level = [&](Node g) { return std::min(variable(g), nbVariables); };
+  const double result =
+      std::ldexp(count(node.low, nbVariables, counted),
+                 static_cast<int>(level(node.low) - node.variable - 1)) +
+      std::ldexp(count(node.high, nbVariables, counted),
+                 static_cast<int>(level(node.high) - node.variable - 1));
+  counted.emplace(f, result);
+  return result;
+}
+
+BSymbolicSet BSymbolicSet::empty(const std::shared_ptr<BddManager> &manager,
+                                 const std::shared_ptr<BType> &type) {
+  return BSymbolicSet(manager, BTypeBddLayout::of(type), BddManager::False);
+}
+
+BSymbolicSet BSymbolicSet::universe(const std::shared_ptr<BddManager> &manager,
+                                    const std::shared_ptr<BType> &type) {
+  auto layout = BTypeBddLayout::of(type);
+  const BddManager::Node root = manager->domain(layout);
+  return BSymbolicSet(manager, std::move(layout), root);
+}
+
+BSymbolicSet BSymbolicSet::singleton(
+    const std::shared_ptr<BddManager> &manager,
+    const std::shared_ptr<BType> &type, uint64_t rank) {
+  auto layout = BTypeBddLayout::of(type);
+  const BddManager::Node root = manager->code(*layout, layout->ordinals(rank));
+  return BSymbolicSet(manager, std::move(layout), root);
+}
+
+BSymbolicSet BSymbolicSet::singleton(
+    const std::shared_ptr<BddManager> &manager, const BValue &value) {
+  const size_t index = value.type().index();
+  if (index == SIZE_MAX)
+    throw BTypeFactory::Exception("Value of a type not in the table");
+  auto layout = BTypeBddLayout::of(BTypeFactory::at(index));
+  const BddManager::Node root = manager->code(*layout, layout->ordinals(value));
+  return BSymbolicSet(manager, std::move(layout), root);
+}
+
+void BSymbolicSet::check(const BSymbolicSet &other) const {
+  if (m_manager != other.m_manager)
+    throw BTypeFactory::Exception("Sets of different BDD managers");
+  if (type() != other.type())
+    throw BTypeFactory::Exception("Sets of different types");
+}
+
+BSymbolicSet BSymbolicSet::unite(const BSymbolicSet &other) const {
+  check(other);
+  return BSymbolicSet(
+      m_manager, m_layout,
+      m_manager->apply(BddManager::Op::Or, m_root, other.m_root));
+}
+
+BSymbolicSet BSymbolicSet::intersect(const BSymbolicSet &other) const {
+  check(other);
+  return BSymbolicSet(
+      m_manager, m_layout,
+      m_manager->apply(BddManager::Op::And, m_root, other.m_root));
+}
+
+BSymbolicSet BSymbolicSet::subtract(const BSymbolicSet &other) const {
+  check(other);
+  return BSymbolicSet(
+      m_manager, m_layout,
+      m_manager->apply(BddManager::Op::Diff, m_root, other.m_root));
+}
+
+BSymbolicSet BSymbolicSet::complement() const {
+  return BSymbolicSet(m_manager, m_layout,
+                      m_manager->apply(BddManager::Op::Diff,
+                                       m_manager->domain(m_layout), m_root));
+}
+
+BSymbolicSet BSymbolicSet::image(const BSymbolicSet &set) const {
+  return relate(set, 0);
+}
+
+BSymbolicSet BSymbolicSet::preimage(const BSymbolicSet &set) const {
+  return relate(set, 1);
+}
+
+// The set is moved to the variables of its side of the relation, conjoined
+// with the relation, and the variables of that side are quantified. The
+// result is moved from the variables of the other side to its own. The bits
+// of an operand keep their relative order in the product, so that renaming
+// preserves the order of the variables.
+BSymbolicSet BSymbolicSet::relate(const BSymbolicSet &set, int side) const {
+  if (type()->getKind() != BType::Kind::ProductType)
+    throw BTypeFactory::Exception("Set is not a relation");
+  if (m_manager != set.m_manager)
+    throw BTypeFactory::Exception("Sets of different BDD managers");
+  const auto product = type()->asProductType();
+  const std::shared_ptr<BType> &from = side == 0 ? product->lhs : product->rhs;
+  const std::shared_ptr<BType> &to = side == 0 ? product->rhs : product->lhs;
+  if (set.type() != from)
+    throw BTypeFactory::Exception("Set is not of the type of the relation");
+
+  auto toLayout = BTypeBddLayout::of(to);
+  const uint32_t lhsWidth = BTypeBddLayout::of(product->lhs)->width();
+  const uint32_t fromFirst = side == 0 ? 0 : lhsWidth;
+  const uint32_t toFirst = side == 0 ? lhsWidth : 0;
+
+  std::vector<uint32_t> setToRelation(set.layout().width());
+  std::vector<uint32_t> quantified;
+  for (uint32_t bit = 0; bit < set.layout().width(); ++bit) {
+    const uint32_t v = m_layout->variable(fromFirst + bit);
+    setToRelation[set.layout().variable(bit)] = v;
+    quantified.push_back(v);
+  }
+  std::vector<uint32_t> relationToResult(m_layout->width());
+  for (uint32_t bit = 0; bit < toLayout->width(); ++bit) {
+    relationToResult[m_layout->variable(toFirst + bit)] =
+        toLayout->variable(bit);
+  }
+
+  BddManager &manager = *m_manager;
+  std::unordered_map<BddManager::Node, BddManager::Node> renamed;
+  const BddManager::Node moved =
+      manager.rename(set.m_root, setToRelation, renamed);
+  const BddManager::Node related =
+      manager.andExists(m_root, moved, manager.cube(quantified));
+  renamed.clear();
+  return BSymbolicSet(m_manager, std::move(toLayout),
+                      manager.rename(related, relationToResult, renamed));
+}
+
+double BSymbolicSet::count() const {
+  std::unordered_map<BddManager::Node, double> counted;
+  const uint32_t width = m_layout->width();
+  const uint32_t top = std::min(m_manager->variable(m_root), width);
+  return std::ldexp(m_manager->count(m_root, width, counted),
+                    static_cast<int>(top));
+}
+
+bool BSymbolicSet::containsOrdinals(
+    const std::vector<uint64_t> &ordinals) const {
+  // Bits of the code, by variable
+  std::vector<bool> bits(m_layout->width());
+  for (size_t i = 0; i < ordinals.size(); ++i) {
+    const auto &field = m_layout->fields()[i];
+    for (uint32_t b = 0; b < field.width; ++b) {
+      bits[m_layout->variable(field.first + b)] =
+          (ordinals[i] >> (field.width - 1 - b)) & 1;
+    }
+  }
+  BddManager::Node f = m_root;
+  while (f != BddManager::False && f != BddManager::True) {
+    const auto &node = m_manager->m_nodes[f];
+    f = bits[node.variable] ? node.high : node.low;
+  }
+  return f == BddManager::True;
+}
+
+bool BSymbolicSet::contains(uint64_t rank) const {
+  if (m_layout->cardinality() != 0 && rank >= m_layout->cardinality())
+    return false;
+  return containsOrdinals(m_layout->ordinals(rank));
+}
+
+bool BSymbolicSet::contains(const BValue &value) const {
+  return containsOrdinals(m_layout->ordinals(value));
+}
+
+// The bits of the code are assigned in code order, the first bit being the
+// most significant bit of the rank, so that the elements come by increasing
+// rank and the enumeration stops after max of them. A non-false cofactor
+// always has an element, so that no branch is a dead end.
+std::vector<uint64_t> BSymbolicSet::ranks(size_t max) const {
+  if (m_layout->cardinality() == 0)
+    throw BTypeFactory::Exception("Too many values to be ranked");
+  const uint32_t width = m_layout->width();
+  std::vector<bool> bits(width);
+  std::vector<uint64_t> result;
+  std::vector<uint64_t> ordinals(m_layout->fields().size());
+  std::unordered_map<BddManager::Node, BddManager::Node> restricted;
+  // Enumerates the assignments of the bits from bit on, f being the set
+  // restricted by the previous bits
+  auto enumerate = [&](auto &self, BddManager::Node f, uint32_t bit) -> void {
+    if (f == BddManager::False || result.size() >= max) return;
+    if (bit == width) {
+      for (size_t i = 0; i < ordinals.size(); ++i) {
+        const auto &field = m_layout->fields()[i];
+        ordinals[i] = 0;
+        for (uint32_t b = 0; b < field.width; ++b)
+          ordinals[i] = ordinals[i] << 1 | bits[field.first + b];
+      }
+      result.push_back(m_layout->rank(ordinals));
+      return;
+    }
+    for (bool value : {false, true}) {
+      restricted.clear();
+      const BddManager::Node g = m_manager->cofactor(
+          f, m_layout->variable(bit), value, restricted);
+      bits[bit] = value;
+      self(self, g, bit + 1);
+    }
+  };
+  enumerate(enumerate, m_root, 0);
+  return result;
+}
+
+size_t BSymbolicSet::nbNodes() const {
+  std::vector<BddManager::Node> stack{m_root};
+  std::unordered_map<BddManager::Node, bool> seen{{m_root, true}};
+  while (!stack.empty()) {
+    const BddManager::Node f = stack.back();
+    stack.pop_back();
+    if (f == BddManager::False || f == BddManager::True) continue;
+    for (BddManager::Node g :
+         {m_manager->m_nodes[f].low, m_manager->m_nodes[f].high}) {
+      if (seen.emplace(g, true).second) stack.push_back(g);
+    }
+  }
+  return seen.size();
+}
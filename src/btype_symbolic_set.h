@@ -0,0 +1,307 @@
+/* @file btype_symbolic_set.h
+   @brief Header file for the BddManager, BTypeBddLayout and BSymbolicSet
+   classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_SYMBOLIC_SET_H
+#define BTYPE_SYMBOLIC_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "btype.h"
+#include "btype_value.h"
+
+class BSymbolicSet;
+
+/**
+ * @brief Bit encoding of the values of a finite B type, and the order of the
+ * BDD variables of the bits.
+ *
+ * Finite types are BOOL, enumerated sets, and products and structs of finite
+ * types. A value is encoded by the ordinals of its scalar parts (fields),
+ * in depth-first order, each ordinal on the fewest bits that hold it, most
+ * significant bit first. An enumerated set with n values thus takes
+ * ceil(log2(n)) bits, and the codes from n on are not values.
+ *
+ * Bit b of the code is BDD variable variable(b); the variables of a type are
+ * 0 to width() - 1. The bits of a product are interleaved: the k-th variable
+ * of the left operand comes just before the k-th variable of the right
+ * operand, so that the BDD of a relation that maps values to similar values
+ * (e.g. an identity or a successor relation) stays small.
+ *
+ * The rank of a value is its position in the mixed-radix numbering of the
+ * ordinals of its fields, the first field being the most significant: the
+ * rank of a pair (x, y) is rank(x) * card(B) + rank(y).
+ */
+class BTypeBddLayout {
+ public:
+  /** @brief A scalar part of a value: a BOOL or an enumerated set. */
+  struct Field {
+    /** @brief The position of the first bit of the field in the code. */
+    uint32_t first;
+    /** @brief The number of bits of the field. */
+    uint32_t width;
+    /** @brief The number of values of the field. */
+    uint64_t cardinality;
+  };
+
+  /**
+   * @brief Computes the layout of a finite type.
+   * @throw BTypeFactory::Exception if the type is not finite
+   */
+  explicit BTypeBddLayout(const std::shared_ptr<BType> &type);
+
+  /**
+   * @brief Gets the layout of a finite type. Layouts are computed on first
+   * use and cached by type index.
+   * @throw BTypeFactory::Exception if the type is not finite
+   */
+  static std::shared_ptr<const BTypeBddLayout> of(
+      const std::shared_ptr<BType> &type);
+
+  /** @brief Gets the type of the values. */
+  const std::shared_ptr<BType> &type() const { return m_type; }
+  /** @brief Gets the number of bits of a code. */
+  uint32_t width() const { return static_cast<uint32_t>(m_variables.size()); }
+  /** @brief Gets the BDD variable of a bit of the code. */
+  uint32_t variable(uint32_t bit) const { return m_variables[bit]; }
+  /** @brief Gets the scalar parts of the values, in depth-first order. */
+  const std::vector<Field> &fields() const { return m_fields; }
+  /**
+   * @brief Gets the number of values of the type, 0 if there are 2^64 or
+   * more.
+   */
+  uint64_t cardinality() const { return m_cardinality; }
+
+  /**
+   * @brief Gets the ordinals of the fields of a rank.
+   * @throw BTypeFactory::Exception if the rank is not less than the
+   * cardinality, or the cardinality is not representable
+   */
+  std::vector<uint64_t> ordinals(uint64_t rank) const;
+  /** @brief Gets the rank of the ordinals of the fields. */
+  uint64_t rank(const std::vector<uint64_t> &ordinals) const;
+  /**
+   * @brief Gets the ordinals of the fields of a value.
+   * @throw BTypeFactory::Exception if the value is not of the type
+   */
+  std::vector<uint64_t> ordinals(const BValue &value) const;
+
+ private:
+  void encode(const BValue &value, std::vector<uint64_t> &ordinals) const;
+
+  std::shared_ptr<BType> m_type;
+  std::vector<uint32_t> m_variables;
+  std::vector<Field> m_fields;
+  uint64_t m_cardinality;
+};
+
+/**
+ * @brief Store of the nodes of reduced ordered binary decision diagrams
+ * (BDD), shared by the symbolic sets created with it.
+ *
+ * Nodes are unique: two sets are equal if and only if they have the same
+ * root. Results of operations are cached. Nodes are kept as long as the
+ * manager: a manager is meant for one analysis. A manager and its sets are
+ * used by one thread at a time.
+ */
+class BddManager {
+ public:
+  BddManager();
+  BddManager(const BddManager &) = delete;
+  BddManager &operator=(const BddManager &) = delete;
+
+  /** @brief Gets the number of nodes, including the two terminals. */
+  size_t size() const { return m_nodes.size(); }
+
+ private:
+  friend class BSymbolicSet;
+
+  using Node = uint32_t;
+  static constexpr Node False = 0;
+  static constexpr Node True = 1;
+  enum class Op : uint32_t { And, Or, Diff, AndExists };
+
+  struct NodeData {
+    uint32_t variable;
+    Node low;
+    Node high;
+  };
+  struct CacheEntry {
+    Op op;
+    Node f;
+    Node g;
+    Node h;
+    Node result;
+  };
+
+  uint32_t variable(Node f) const { return m_nodes[f].variable; }
+  Node make(uint32_t variable, Node low, Node high);
+  Node apply(Op op, Node f, Node g);
+  Node andExists(Node f, Node g, Node cube);
+  // f with a variable set to a value
+  Node cofactor(Node f, uint32_t variable, bool value,
+                std::unordered_map<Node, Node> &restricted);
+  // The variables of f are renamed by map, which must preserve their order
+  Node rename(Node f, const std::vector<uint32_t> &map,
+              std::unordered_map<Node, Node> &renamed);
+  // The codes less than bound of a field
+  Node lessThan(const BTypeBddLayout &layout,
+                const BTypeBddLayout::Field &field, uint64_t bound);
+  // The valid codes of a layout
+  Node domain(const std::shared_ptr<const BTypeBddLayout> &layout);
+  // The code of the ordinals of the fields
+  Node code(const BTypeBddLayout &layout,
+            const std::vector<uint64_t> &ordinals);
+  Node cube(const std::vector<uint32_t> &variables);
+  // The number of assignments of the variables 0 to nbVariables - 1 that
+  // satisfy f
+  double count(Node f, uint32_t nbVariables,
+               std::unordered_map<Node, double> &counted) const;
+  void grow();
+
+  std::vector<NodeData> m_nodes;
+  // Open addressing table of the nodes, at most half full
+  std::vector<Node> m_unique;
+  // Direct-mapped cache of the operations
+  std::vector<CacheEntry> m_cache;
+  std::unordered_map<const BTypeBddLayout *,
+                     std::pair<std::shared_ptr<const BTypeBddLayout>, Node>>
+      m_domains;
+};
+
+/**
+ * @brief Set of values of a finite B type, represented symbolically by a BDD
+ * over the bits of the codes of its elements (see BTypeBddLayout).
+ *
+ * Sets are immutable values; the operations return new sets. A relation is a
+ * set of pairs, i.e. a subset of a type A * B, and has image and preimage
+ * operations. The size of a set is the size of its BDD, not its number of
+ * elements: a set of 10^12 elements with a regular structure may take a few
+ * nodes.
+ *
+ * @code
+ * auto manager = std::make_shared<BddManager>();
+ * auto next = BSymbolicSet::empty(manager, BTypeFactory::Product(s, s));
+ * for (uint64_t i = 0; i + 1 < n; ++i)
+ *   next = next.unite(BSymbolicSet::singleton(manager, next.type(),
+ *                                             i * n + i + 1));
+ * auto reached = next.image(BSymbolicSet::singleton(manager, s, 0));
+ * @endcode
+ */
+class BSymbolicSet {
+ public:
+  /**
+   * @brief Gets the empty set of elements of a type.
+   * @throw BTypeFactory::Exception if the type is not finite
+   */
+  static BSymbolicSet empty(const std::shared_ptr<BddManager> &manager,
+                            const std::shared_ptr<BType> &type);
+  /** @brief Gets the set of all the values of a type. */
+  static BSymbolicSet universe(const std::shared_ptr<BddManager> &manager,
+                               const std::shared_ptr<BType> &type);
+  /**
+   * @brief Gets the set of a value given by its rank.
+   * @throw BTypeFactory::Exception if the rank is out of range
+   */
+  static BSymbolicSet singleton(const std::shared_ptr<BddManager> &manager,
+                                const std::shared_ptr<BType> &type,
+                                uint64_t rank);
+  /**
+   * @brief Gets the set of a value.
+   * @throw BTypeFactory::Exception if the value is not of a finite type
+   */
+  static BSymbolicSet singleton(const std::shared_ptr<BddManager> &manager,
+                                const BValue &value);
+
+  /** @brief Gets the type of the elements. */
+  const std::shared_ptr<BType> &type() const { return m_layout->type(); }
+  /** @brief Gets the encoding of the elements. */
+  const BTypeBddLayout &layout() const { return *m_layout; }
+
+  /**
+   * @brief Set operations. The sets must have the same manager and type.
+   * @throw BTypeFactory::Exception otherwise
+   */
+  BSymbolicSet unite(const BSymbolicSet &other) const;
+  BSymbolicSet intersect(const BSymbolicSet &other) const;
+  BSymbolicSet subtract(const BSymbolicSet &other) const;
+  /** @brief Gets the values of the type that are not in the set. */
+  BSymbolicSet complement() const;
+
+  /**
+   * @brief Gets the image of a set by this relation: the y such that
+   * (x, y) is in the relation for some x of the set.
+   * @param set a set of elements of A, this set being a subset of A * B
+   * @throw BTypeFactory::Exception if this set is not a relation, or the
+   * types or managers do not match
+   */
+  BSymbolicSet image(const BSymbolicSet &set) const;
+  /**
+   * @brief Gets the preimage of a set by this relation: the x such that
+   * (x, y) is in the relation for some y of the set.
+   * @param set a set of elements of B, this set being a subset of A * B
+   */
+  BSymbolicSet preimage(const BSymbolicSet &set) const;
+
+  /** @brief Tells whether the set has no element. */
+  bool isEmpty() const { return m_root == BddManager::False; }
+  /** @brief Gets the number of elements. */
+  double count() const;
+  /** @brief Tells whether the value of a rank is in the set. */
+  bool contains(uint64_t rank) const;
+  /** @brief Tells whether a value is in the set. */
+  bool contains(const BValue &value) const;
+  /**
+   * @brief Gets the ranks of the elements, in increasing order.
+   * @param max the maximal number of ranks: the max smallest ones are returned
+   */
+  std::vector<uint64_t> ranks(size_t max = SIZE_MAX) const;
+
+  /** @brief Gets the number of nodes of the BDD, terminals included. */
+  size_t nbNodes() const;
+
+  bool operator==(const BSymbolicSet &other) const {
+    return m_manager == other.m_manager && type() == other.type() &&
+           m_root == other.m_root;
+  }
+  bool operator!=(const BSymbolicSet &other) const {
+    return !(*this == other);
+  }
+
+ private:
+  BSymbolicSet(std::shared_ptr<BddManager> manager,
+               std::shared_ptr<const BTypeBddLayout> layout,
+               BddManager::Node root)
+      : m_manager{std::move(manager)},
+        m_layout{std::move(layout)},
+        m_root{root} {}
+  void check(const BSymbolicSet &other) const;
+  bool containsOrdinals(const std::vector<uint64_t> &ordinals) const;
+  // Image (side 0) or preimage (side 1)
+  BSymbolicSet relate(const BSymbolicSet &set, int side) const;
+
+  std::shared_ptr<BddManager> m_manager;
+  std::shared_ptr<const BTypeBddLayout> m_layout;
+  BddManager::Node m_root;
+};
+
+#endif  // BTYPE_SYMBOLIC_SET_H
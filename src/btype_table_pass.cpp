@@ -0,0 +1,41 @@
+/* @file btype_table_pass.cpp
+   @brief Implementation file for the BTypeTablePass class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_table_pass.h"
+
+#include <algorithm>
+
+BTypeTablePass::BTypeTablePass(unsigned nbThreads)
+    : m_nbThreads{nbThreads} {
+  const size_t n = BTypeFactory::size();
+  m_types.reserve(n);
+  for (size_t i = 0; i < n; ++i) m_types.push_back(BTypeFactory::at(i));
+
+  // Sub-types are indexed before the types that contain them, so a single
+  // forward scan computes all levels.
+  m_level.resize(n, 0);
+  for (size_t i = 0; i < n; ++i) {
+    size_t level = 0;
+    m_types[i]->forEachChild([&](const std::shared_ptr<BType> &child) {
+      level = std::max(level, m_level[child->index()] + 1);
+    });
+    m_level[i] = level;
+    if (m_levels.size() <= level) m_levels.resize(level + 1);
+    m_levels[level].push_back(i);
+  }
+}
@@ -0,0 +1,117 @@
+/* @file btype_table_pass.h
+   @brief Header file for the BTypeTablePass class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_TABLE_PASS_H
+#define BTYPE_TABLE_PASS_H
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "btype.h"
+#include "btype_parallel.h"
+
+/**
+ * @brief Computes a derived attribute for every type of the BTypeFactory
+ * table, in parallel.
+ *
+ * The pass works on a snapshot of the table taken at construction: the types
+ * at indices 0 to size()-1. The types are grouped by level: basic types,
+ * abstract and enumerated sets have level 0, and any other type has a level
+ * one above the highest level of its sub-types. Levels are processed in
+ * increasing order, and the types of a level are processed concurrently, so
+ * that the attribute of a type may be computed from the attributes of its
+ * sub-types.
+ *
+ * Example: computing the number of nodes in the tree of each type.
+ * @code
+ * BTypeTablePass pass;
+ * std::vector<size_t> sizes = pass.run<size_t>(
+ *     [](const BType &type, const std::vector<size_t> &sizes) {
+ *       size_t result = 1;
+ *       type.forEachChild([&](const std::shared_ptr<BType> &child) {
+ *         result += sizes[child->index()];
+ *       });
+ *       return result;
+ *     });
+ * @endcode
+ */
+class BTypeTablePass {
+ public:
+  /**
+   * @brief Takes a snapshot of the type table and computes the levels.
+   * @param nbThreads number of threads used by run(); 0 means one per
+   * hardware thread
+   */
+  explicit BTypeTablePass(unsigned nbThreads = 0);
+
+  /** @brief Gets the number of types in the snapshot. */
+  size_t size() const { return m_types.size(); }
+
+  /** @brief Gets the type at the given index of the snapshot. */
+  const std::shared_ptr<BType> &at(size_t index) const {
+    return m_types[index];
+  }
+
+  /** @brief Gets the level of the type at the given index. */
+  size_t level(size_t index) const { return m_level[index]; }
+
+  /** @brief Gets the indices of the types, grouped by level. */
+  const std::vector<std::vector<size_t>> &levels() const { return m_levels; }
+
+  /**
+   * @brief Computes an attribute for every type of the snapshot.
+   * @tparam T the type of the attribute; it must be default constructible
+   * @param f a callable with signature T(const BType &, const std::vector<T>
+   * &). The second argument holds the results computed so far; f may read the
+   * entries of the sub-types of its first argument, and nothing else.
+   * @return the attributes, such that the attribute of type t is at position
+   * t->index()
+   * @throw the first exception raised by f
+   */
+  template <typename T, typename F>
+  std::vector<T> run(F &&f) const {
+    static_assert(!std::is_same<T, bool>::value,
+                  "std::vector<bool> does not support concurrent writes");
+    std::vector<T> results(m_types.size());
+    btypeParallel::runLevels(m_levels, m_nbThreads, [&](size_t index) {
+      results[index] = f(static_cast<const BType &>(*m_types[index]),
+                         static_cast<const std::vector<T> &>(results));
+    });
+    return results;
+  }
+
+  /**
+   * @brief Applies a function to every type of the snapshot, sub-types first.
+   * @param f a callable with signature void(const BType &)
+   */
+  template <typename F>
+  void forEach(F &&f) const {
+    btypeParallel::runLevels(m_levels, m_nbThreads, [&](size_t index) {
+      f(static_cast<const BType &>(*m_types[index]));
+    });
+  }
+
+ private:
+  unsigned m_nbThreads;
+  std::vector<std::shared_ptr<BType>> m_types;
+  std::vector<size_t> m_level;
+  std::vector<std::vector<size_t>> m_levels;
+};
+
+#endif  // BTYPE_TABLE_PASS_H
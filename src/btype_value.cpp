@@ -0,0 +1,293 @@
+/* @file btype_value.cpp
+   @brief Implementation file for the BValue and BValueBatch classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_value.h"
+
+#include <cstdio>
+
+namespace {
+
+template <typename T>
+int order(T a, T b) {
+  return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+// The sub-type of a pair (position 0 or 1), set (0) or struct value
+const BType &subType(const BType &type, size_t position) {
+  switch (type.getKind()) {
+    case BType::Kind::ProductType: {
+      const auto &product = static_cast<const BType::ProductType &>(type);
+      return position == 0 ? *product.lhs : *product.rhs;
+    }
+    case BType::Kind::PowerType:
+      return *static_cast<const BType::PowerType &>(type).m_content;
+    default:
+      return *static_cast<const BType::StructType &>(type)
+                  .m_fields[position]
+                  .second;
+  }
+}
+
+// Whether the values of a type are ordered by their members
+bool hasMembers(const BType &type) {
+  switch (type.getKind()) {
+    case BType::Kind::ProductType:
+    case BType::Kind::PowerType:
+    case BType::Kind::Struct:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+void BValueBatch::clear() {
+  m_cells.clear();
+  m_children.clear();
+  m_chars.clear();
+  m_roots.clear();
+}
+
+// Orders the cells themselves: scalars, and sets by size. Pairs, structs and
+// sets of the same size are then ordered by their members.
+int BValueBatch::compareCells(const BType &type, uint32_t cell1,
+                              uint32_t cell2) const {
+  const Cell &c1 = m_cells[cell1];
+  const Cell &c2 = m_cells[cell2];
+  switch (type.getKind()) {
+    case BType::Kind::INTEGER:
+    case BType::Kind::BOOLEAN:
+    case BType::Kind::AbstractSet:
+    case BType::Kind::EnumeratedSet:
+      return order(c1.integer, c2.integer);
+    case BType::Kind::FLOAT:
+    case BType::Kind::REAL:
+      return order(c1.real, c2.real);
+    case BType::Kind::STRING:
+      return std::string_view(m_chars).substr(c1.first, c1.count).compare(
+          std::string_view(m_chars).substr(c2.first, c2.count));
+    case BType::Kind::PowerType:
+      return order(c1.count, c2.count);
+    default:
+      return 0;
+  }
+}
+
+// Members are compared in lexicographic order with an explicit stack, so
+// that deep values do not exhaust the thread stack.
+int BValueBatch::compare(const BType &type, uint32_t cell1,
+                         uint32_t cell2) const {
+  if (cell1 == cell2) return 0;
+  int result = compareCells(type, cell1, cell2);
+  if (result != 0 || !hasMembers(type)) return result;
+
+  struct Pending {
+    const BType *type;
+    uint32_t cell1;
+    uint32_t cell2;
+    uint32_t next;
+  };
+  // The members of current are compared; stack holds its ancestors
+  Pending current{&type, cell1, cell2, 0};
+  std::vector<Pending> stack;
+  for (;;) {
+    const Cell &c1 = m_cells[current.cell1];
+    if (current.next == c1.count) {
+      if (stack.empty()) return 0;
+      current = stack.back();
+      stack.pop_back();
+      continue;
+    }
+    const uint32_t i = current.next++;
+    const BType &member = subType(*current.type, i);
+    const uint32_t m1 = m_children[c1.first + i];
+    const uint32_t m2 = m_children[m_cells[current.cell2].first + i];
+    if (m1 == m2) continue;
+    result = compareCells(member, m1, m2);
+    if (result != 0) return result;
+    if (hasMembers(member)) {
+      stack.push_back(current);
+      current = {&member, m1, m2, 0};
+    }
+  }
+}
+
+void BValue::check(BType::Kind kind) const {
+  if (m_type->getKind() != kind)
+    throw BTypeFactory::Exception("Value does not have the expected type");
+}
+
+bool BValue::asBoolean() const {
+  check(BType::Kind::BOOLEAN);
+  return m_batch->m_cells[m_cell].integer != 0;
+}
+
+int64_t BValue::asInteger() const {
+  check(BType::Kind::INTEGER);
+  return m_batch->m_cells[m_cell].integer;
+}
+
+double BValue::asReal() const {
+  if (m_type->getKind() != BType::Kind::FLOAT) check(BType::Kind::REAL);
+  return m_batch->m_cells[m_cell].real;
+}
+
+std::string_view BValue::asString() const {
+  check(BType::Kind::STRING);
+  const auto &cell = m_batch->m_cells[m_cell];
+  return std::string_view(m_batch->m_chars).substr(cell.first, cell.count);
+}
+
+uint64_t BValue::ordinal() const {
+  if (m_type->getKind() != BType::Kind::AbstractSet)
+    check(BType::Kind::EnumeratedSet);
+  return static_cast<uint64_t>(m_batch->m_cells[m_cell].integer);
+}
+
+BValue BValue::first() const {
+  check(BType::Kind::ProductType);
+  const auto &cell = m_batch->m_cells[m_cell];
+  return BValue(*m_batch, subType(*m_type, 0),
+                m_batch->m_children[cell.first]);
+}
+
+BValue BValue::second() const {
+  check(BType::Kind::ProductType);
+  const auto &cell = m_batch->m_cells[m_cell];
+  return BValue(*m_batch, subType(*m_type, 1),
+                m_batch->m_children[cell.first + 1]);
+}
+
+size_t BValue::size() const {
+  if (m_type->getKind() != BType::Kind::Struct)
+    check(BType::Kind::PowerType);
+  return m_batch->m_cells[m_cell].count;
+}
+
+BValue BValue::element(size_t position) const {
+  const auto &cell = m_batch->m_cells[m_cell];
+  if (position >= size())
+    throw BTypeFactory::Exception("Element position out of range");
+  const bool isSet = m_type->getKind() == BType::Kind::PowerType;
+  return BValue(*m_batch, subType(*m_type, isSet ? 0 : position),
+                m_batch->m_children[cell.first + position]);
+}
+
+int BValue::compare(const BValue &v1, const BValue &v2) {
+  if (v1.m_batch == v2.m_batch)
+    return v1.m_batch->compare(*v1.m_type, v1.m_cell, v2.m_cell);
+  // Values of different batches: compare member by member
+  switch (v1.m_type->getKind()) {
+    case BType::Kind::INTEGER:
+    case BType::Kind::BOOLEAN:
+    case BType::Kind::AbstractSet:
+    case BType::Kind::EnumeratedSet:
+      return order(v1.m_batch->m_cells[v1.m_cell].integer,
+                   v2.m_batch->m_cells[v2.m_cell].integer);
+    case BType::Kind::FLOAT:
+    case BType::Kind::REAL:
+      return order(v1.asReal(), v2.asReal());
+    case BType::Kind::STRING:
+      return v1.asString().compare(v2.asString());
+    case BType::Kind::ProductType: {
+      const int result = compare(v1.first(), v2.first());
+      return result != 0 ? result : compare(v1.second(), v2.second());
+    }
+    default:
+      if (v1.size() != v2.size()) return order(v1.size(), v2.size());
+      for (size_t i = 0; i < v1.size(); ++i) {
+        const int result = compare(v1.element(i), v2.element(i));
+        if (result != 0) return result;
+      }
+      return 0;
+  }
+}
+
+std::string BValue::toString() const {
+  std::string result;
+  print(result);
+  return result;
+}
+
+void BValue::print(std::string &out) const {
+  const auto &cell = m_batch->m_cells[m_cell];
+  switch (m_type->getKind()) {
+    case BType::Kind::INTEGER:
+      out += std::to_string(cell.integer);
+      break;
+    case BType::Kind::BOOLEAN:
+      out += cell.integer != 0 ? "TRUE" : "FALSE";
+      break;
+    case BType::Kind::FLOAT:
+    case BType::Kind::REAL: {
+      char buffer[32];
+      std::snprintf(buffer, sizeof buffer, "%.17g", cell.real);
+      out += buffer;
+      // B real literals have a decimal point
+      if (std::string_view(buffer).find_first_of(".en") ==
+          std::string_view::npos)
+        out += ".0";
+      break;
+    }
+    case BType::Kind::STRING:
+      out.push_back('"');
+      for (char c : asString()) {
+        if (c == '"' || c == '\\') out.push_back('\\');
+        out.push_back(c);
+      }
+      out.push_back('"');
+      break;
+    case BType::Kind::AbstractSet:
+      out += static_cast<const BType::AbstractSet &>(*m_type).getName();
+      out += std::to_string(cell.integer + 1);
+      break;
+    case BType::Kind::EnumeratedSet:
+      out += static_cast<const BType::EnumeratedSet &>(*m_type)
+                 .getValues()[cell.integer];
+      break;
+    case BType::Kind::ProductType:
+      out.push_back('(');
+      first().print(out);
+      out += "|->";
+      second().print(out);
+      out.push_back(')');
+      break;
+    case BType::Kind::PowerType:
+      out.push_back('{');
+      for (size_t i = 0; i < cell.count; ++i) {
+        if (i != 0) out.push_back(',');
+        element(i).print(out);
+      }
+      out.push_back('}');
+      break;
+    case BType::Kind::Struct: {
+      const auto &fields =
+          static_cast<const BType::StructType &>(*m_type).getFields();
+      out += "rec(";
+      for (size_t i = 0; i < cell.count; ++i) {
+        if (i != 0) out.push_back(',');
+        out += fields[i].first;
+        out.push_back(':');
+        element(i).print(out);
+      }
+      out.push_back(')');
+      break;
+    }
+  }
+}
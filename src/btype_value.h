@@ -0,0 +1,146 @@
+/* @file btype_value.h
+   @brief Header file for the BValue and BValueBatch classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_VALUE_H
+#define BTYPE_VALUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "btype.h"
+
+class BValueBatch;
+class BValueGenerator;
+
+/**
+ * @brief Read-only view of a value of a B type, stored in a BValueBatch.
+ *
+ * A view is only valid as long as the batch holding it is not modified or
+ * destroyed. The accessors throw BTypeFactory::Exception when they do not
+ * apply to the type of the value.
+ */
+class BValue {
+ public:
+  /** @brief Gets the type of the value. */
+  const BType &type() const { return *m_type; }
+
+  /** @brief Gets a BOOL value. */
+  bool asBoolean() const;
+  /** @brief Gets an INTEGER value. */
+  int64_t asInteger() const;
+  /** @brief Gets a REAL or FLOAT value. */
+  double asReal() const;
+  /** @brief Gets a STRING value. */
+  std::string_view asString() const;
+  /**
+   * @brief Gets the position of an element of an enumerated set among the
+   * values of the set, or of an element of an abstract set among the elements
+   * generated for that set.
+   */
+  uint64_t ordinal() const;
+  /** @brief Gets the left member of a pair. */
+  BValue first() const;
+  /** @brief Gets the right member of a pair. */
+  BValue second() const;
+  /** @brief Gets the number of elements of a set, or of fields of a struct. */
+  size_t size() const;
+  /**
+   * @brief Gets an element of a set, in increasing order, or a field of a
+   * struct, in the order of the fields of the type.
+   */
+  BValue element(size_t position) const;
+
+  /**
+   * @brief Prints the value in B syntax. Elements of an abstract set S are
+   * printed S1, S2, ...
+   */
+  std::string toString() const;
+
+  /**
+   * @brief Compares two values of the same type.
+   * @return a negative number, 0 or a positive number, when v1 is
+   * respectively less than, equal to or greater than v2. Sets are ordered by
+   * size first.
+   */
+  static int compare(const BValue &v1, const BValue &v2);
+
+ private:
+  friend class BValueBatch;
+  BValue(const BValueBatch &batch, const BType &type, uint32_t cell)
+      : m_batch{&batch}, m_type{&type}, m_cell{cell} {}
+  void check(BType::Kind kind) const;
+  void print(std::string &out) const;
+
+  const BValueBatch *m_batch;
+  const BType *m_type;
+  uint32_t m_cell;
+};
+
+/**
+ * @brief A sequence of values of the same B type.
+ *
+ * Values are stored in flat arrays that are kept when the batch is cleared,
+ * so that refilling a batch does not allocate once it has reached its size.
+ * Batches are filled by BValueGenerator.
+ */
+class BValueBatch {
+ public:
+  /** @brief Gets the type of the values, nullptr if the batch was never
+   * filled. */
+  const std::shared_ptr<BType> &type() const { return m_type; }
+  /** @brief Gets the number of values. */
+  size_t size() const { return m_roots.size(); }
+  /** @brief Gets a value. */
+  BValue operator[](size_t position) const {
+    return BValue(*this, *m_type, m_roots[position]);
+  }
+  /** @brief Removes the values, keeping the storage. */
+  void clear();
+
+ private:
+  friend class BValue;
+  friend class BValueGenerator;
+
+  // A node of a value. Scalars are in the payload; strings are a range of
+  // m_chars; pairs, sets and structs are a range of m_children.
+  struct Cell {
+    union {
+      int64_t integer;
+      double real;
+    };
+    uint32_t first;
+    uint32_t count;
+  };
+
+  int compare(const BType &type, uint32_t cell1, uint32_t cell2) const;
+  int compareCells(const BType &type, uint32_t cell1, uint32_t cell2) const;
+
+  std::shared_ptr<BType> m_type;
+  std::vector<Cell> m_cells;
+  std::vector<uint32_t> m_children;
+  std::string m_chars;
+  std::vector<uint32_t> m_roots;
+  // Work space of the generator
+  std::vector<uint32_t> m_scratch;
+};
+
+#endif  // BTYPE_VALUE_H
@@ -0,0 +1,312 @@
+/* @file btype_value_generator.cpp
+   @brief Implementation file for the BValueGenerator class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "btype_value_generator.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+#include "btype_index_memo.h"
+
+namespace {
+
+// Largest number of values of a type drawn uniformly
+constexpr uint64_t maxCardinality = uint64_t(1) << 62;
+
+constexpr char alphabet[] =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+constexpr uint64_t alphabetSize = sizeof alphabet - 1;
+
+// Returned instead of a cell when a value is not made yet; push never makes
+// this many cells
+constexpr uint32_t noCell = UINT32_MAX;
+
+}  // namespace
+
+BValueGenerator::BValueGenerator(const std::shared_ptr<BType> &type,
+                                 const Options &options)
+    : m_type{type}, m_options{options} {
+  if (!type) throw BTypeFactory::Exception("Null type");
+  if (options.minInteger > options.maxInteger ||
+      !(options.minReal <= options.maxReal))
+    throw BTypeFactory::Exception("Invalid bounds");
+  compile(*type);
+}
+
+// Walks the type in post-order with an explicit stack, so that deep types do
+// not exhaust the thread stack: the step of a type is added once the steps
+// of all its children are.
+void BValueGenerator::compile(const BType &root) {
+  std::unordered_map<const BType *, uint32_t> compiled;
+  std::vector<std::pair<const BType *, bool>> stack{{&root, false}};
+  std::vector<uint32_t> children;
+  while (!stack.empty()) {
+    const auto [type, expanded] = stack.back();
+    if (compiled.count(type) != 0) {
+      stack.pop_back();
+    } else if (!expanded) {
+      stack.back().second = true;
+      type->forEachChild([&](const std::shared_ptr<BType> &child) {
+        if (compiled.count(child.get()) == 0)
+          stack.emplace_back(child.get(), false);
+      });
+    } else {
+      stack.pop_back();
+      children.clear();
+      type->forEachChild([&](const std::shared_ptr<BType> &child) {
+        children.push_back(compiled.at(child.get()));
+      });
+      compiled.emplace(type, addStep(*type, children));
+    }
+  }
+}
+
+uint32_t BValueGenerator::addStep(const BType &type,
+                                  const std::vector<uint32_t> &children) {
+  Step step{&type, 0, static_cast<uint32_t>(m_stepChildren.size()),
+            static_cast<uint32_t>(children.size())};
+  m_stepChildren.insert(m_stepChildren.end(), children.begin(),
+                        children.end());
+
+  uint64_t cardinality = 0;
+  switch (type.getKind()) {
+    case BType::Kind::BOOLEAN:
+      cardinality = 2;
+      break;
+    case BType::Kind::EnumeratedSet:
+      cardinality =
+          static_cast<const BType::EnumeratedSet &>(type).getValues().size();
+      if (cardinality == 0)
+        throw BTypeFactory::Exception("Enumerated set without values");
+      break;
+    case BType::Kind::AbstractSet:
+      cardinality = m_options.abstractSetSize;
+      if (cardinality == 0)
+        throw BTypeFactory::Exception("Abstract set without elements");
+      break;
+    case BType::Kind::ProductType:
+    case BType::Kind::Struct:
+      cardinality = 1;
+      for (uint32_t child : children) {
+        const uint64_t c = m_steps[child].cardinality;
+        if (c == 0 || cardinality > maxCardinality / c) {
+          cardinality = 0;
+          break;
+        }
+        cardinality *= c;
+      }
+      break;
+    case BType::Kind::PowerType: {
+      const uint64_t c = m_steps[children[0]].cardinality;
+      if (c != 0 && c < 63) cardinality = uint64_t(1) << c;
+      break;
+    }
+    default:
+      break;
+  }
+  if (m_options.uniform) step.cardinality = cardinality;
+
+  m_steps.push_back(step);
+  return static_cast<uint32_t>(m_steps.size() - 1);
+}
+
+std::shared_ptr<const BValueGenerator> BValueGenerator::of(
+    const std::shared_ptr<BType> &type) {
+  static BTypeIndexMemo<std::shared_ptr<const BValueGenerator>> memo;
+  return memo.get(
+      *type, [&] { return std::make_shared<const BValueGenerator>(type); });
+}
+
+void BValueGenerator::fill(BRandom &random, size_t count,
+                           BValueBatch &batch) const {
+  batch.clear();
+  batch.m_type = m_type;
+  batch.m_roots.reserve(count);
+  const auto root = static_cast<uint32_t>(m_steps.size() - 1);
+  std::vector<Frame> frames;
+  for (size_t i = 0; i < count; ++i)
+    batch.m_roots.push_back(generate(root, random, batch, frames));
+}
+
+uint32_t BValueGenerator::push(BValueBatch &batch,
+                               const BValueBatch::Cell &cell) {
+  if (batch.m_cells.size() >= UINT32_MAX ||
+      batch.m_children.size() >= UINT32_MAX ||
+      batch.m_chars.size() >= UINT32_MAX)
+    throw BTypeFactory::Exception("Value batch too large");
+  batch.m_cells.push_back(cell);
+  return static_cast<uint32_t>(batch.m_cells.size() - 1);
+}
+
+// Makes a pair, set or struct from the cells pushed on the scratch stack
+// since start.
+uint32_t BValueGenerator::makeNode(size_t start, BValueBatch &batch) {
+  auto &scratch = batch.m_scratch;
+  BValueBatch::Cell cell{};
+  cell.first = static_cast<uint32_t>(batch.m_children.size());
+  cell.count = static_cast<uint32_t>(scratch.size() - start);
+  batch.m_children.insert(batch.m_children.end(), scratch.begin() + start,
+                          scratch.end());
+  scratch.resize(start);
+  return push(batch, cell);
+}
+
+// Sets are stored with their elements sorted and without duplicates
+uint32_t BValueGenerator::makeSet(uint32_t step, size_t start,
+                                  BValueBatch &batch) const {
+  const BType &element = *m_steps[m_stepChildren[m_steps[step].first]].type;
+  auto &scratch = batch.m_scratch;
+  std::sort(scratch.begin() + start, scratch.end(),
+            [&](uint32_t a, uint32_t b) {
+              return batch.compare(element, a, b) < 0;
+            });
+  scratch.erase(std::unique(scratch.begin() + start, scratch.end(),
+                            [&](uint32_t a, uint32_t b) {
+                              return batch.compare(element, a, b) == 0;
+                            }),
+                scratch.end());
+  return makeNode(start, batch);
+}
+
+// Makes the value of a step: the value of the given rank if ranked, a random
+// one otherwise, drawn by rank if the step is uniform. Scalars are made at
+// once; tuples and sets get a frame and noCell is returned.
+uint32_t BValueGenerator::open(uint32_t step, bool ranked, uint64_t rank,
+                               BRandom &random, BValueBatch &batch,
+                               std::vector<Frame> &frames) const {
+  const Step &s = m_steps[step];
+  if (!ranked && s.cardinality != 0) {
+    ranked = true;
+    rank = random.below(s.cardinality);
+  }
+  const size_t start = batch.m_scratch.size();
+  switch (s.type->getKind()) {
+    case BType::Kind::ProductType:
+    case BType::Kind::Struct:
+      frames.push_back({step, 0, ranked, rank, s.cardinality, 0, start});
+      return noCell;
+    case BType::Kind::PowerType: {
+      const uint64_t size =
+          ranked ? 0 : random.below(m_options.maxSetSize + 1ULL);
+      frames.push_back({step, 0, ranked, rank, 0, size, start});
+      return noCell;
+    }
+    default:
+      break;
+  }
+  if (!ranked) return scalar(step, random, batch);
+  BValueBatch::Cell cell{};
+  cell.integer = static_cast<int64_t>(rank);
+  return push(batch, cell);
+}
+
+// Makes the members of tuples and sets in order, with an explicit stack of
+// frames, so that deep types do not exhaust the thread stack. A ranked value
+// is decoded from its rank: the digits of the rank in the mixed radix of the
+// cardinalities of the members for tuples, the characteristic bits of the
+// subset for sets.
+uint32_t BValueGenerator::generate(uint32_t root, BRandom &random,
+                                   BValueBatch &batch,
+                                   std::vector<Frame> &frames) const {
+  frames.clear();
+  uint32_t value = open(root, false, 0, random, batch, frames);
+  while (!frames.empty()) {
+    if (value != noCell) batch.m_scratch.push_back(value);
+    Frame &frame = frames.back();
+    const Step &s = m_steps[frame.step];
+    const bool isSet = s.type->getKind() == BType::Kind::PowerType;
+    uint32_t child = m_stepChildren[s.first];
+    uint64_t rank = 0;
+    bool done;
+    if (!isSet) {
+      done = frame.next == s.count;
+      if (!done) {
+        child = m_stepChildren[s.first + frame.next++];
+        if (frame.ranked) {
+          frame.weight /= m_steps[child].cardinality;
+          rank = frame.rank / frame.weight;
+          frame.rank %= frame.weight;
+        }
+      }
+    } else if (frame.ranked) {
+      while (frame.rank >> frame.next != 0 &&
+             ((frame.rank >> frame.next) & 1) == 0)
+        ++frame.next;
+      done = frame.rank >> frame.next == 0;
+      rank = frame.next++;
+    } else {
+      done = frame.left == 0;
+      if (!done) --frame.left;
+    }
+    if (done) {
+      value = isSet ? makeSet(frame.step, frame.start, batch)
+                    : makeNode(frame.start, batch);
+      frames.pop_back();
+    } else {
+      value = open(child, frame.ranked, rank, random, batch, frames);
+    }
+  }
+  return value;
+}
+
+uint32_t BValueGenerator::scalar(uint32_t step, BRandom &random,
+                                 BValueBatch &batch) const {
+  const Step &s = m_steps[step];
+  BValueBatch::Cell cell{};
+  switch (s.type->getKind()) {
+    case BType::Kind::INTEGER: {
+      const uint64_t span = static_cast<uint64_t>(m_options.maxInteger) -
+                            static_cast<uint64_t>(m_options.minInteger) + 1;
+      const uint64_t offset = span == 0 ? random.next() : random.below(span);
+      cell.integer = static_cast<int64_t>(
+          static_cast<uint64_t>(m_options.minInteger) + offset);
+      break;
+    }
+    case BType::Kind::BOOLEAN:
+      cell.integer = static_cast<int64_t>(random.below(2));
+      break;
+    case BType::Kind::FLOAT:
+    case BType::Kind::REAL:
+      cell.real = m_options.minReal +
+                  (m_options.maxReal - m_options.minReal) * random.unit();
+      break;
+    case BType::Kind::STRING: {
+      const auto length = random.below(m_options.maxStringLength + 1ULL);
+      cell.first = static_cast<uint32_t>(batch.m_chars.size());
+      cell.count = static_cast<uint32_t>(length);
+      for (uint64_t i = 0; i < length; ++i)
+        batch.m_chars.push_back(alphabet[random.below(alphabetSize)]);
+      break;
+    }
+    case BType::Kind::AbstractSet:
+      cell.integer =
+          static_cast<int64_t>(random.below(m_options.abstractSetSize));
+      break;
+    case BType::Kind::EnumeratedSet:
+      cell.integer = static_cast<int64_t>(random.below(
+          static_cast<const BType::EnumeratedSet &>(*s.type)
+              .getValues()
+              .size()));
+      break;
+    default:
+      // Tuples and sets are made by generate
+      break;
+  }
+  return push(batch, cell);
+}
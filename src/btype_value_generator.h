@@ -0,0 +1,201 @@
+/* @file btype_value_generator.h
+   @brief Header file for the BRandom and BValueGenerator classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_VALUE_GENERATOR_H
+#define BTYPE_VALUE_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "btype.h"
+#include "btype_value.h"
+
+/**
+ * @brief Seeded pseudo-random number generator (xoshiro256**).
+ *
+ * The state is initialized from the seed with splitmix64, so that any seed,
+ * including 0, gives a good sequence. Not suitable for cryptography.
+ */
+class BRandom {
+ public:
+  explicit BRandom(uint64_t seed) {
+    for (auto &word : m_state) {
+      seed += 0x9e3779b97f4a7c15ULL;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      word = z ^ (z >> 31);
+    }
+  }
+
+  /** @brief Gets the next 64 random bits. */
+  uint64_t next() {
+    const uint64_t result = rotl(m_state[1] * 5, 7) * 9;
+    const uint64_t t = m_state[1] << 17;
+    m_state[2] ^= m_state[0];
+    m_state[3] ^= m_state[1];
+    m_state[1] ^= m_state[2];
+    m_state[0] ^= m_state[3];
+    m_state[2] ^= t;
+    m_state[3] = rotl(m_state[3], 45);
+    return result;
+  }
+
+  /**
+   * @brief Gets a number uniformly distributed in [0, bound).
+   * @param bound a positive number
+   */
+  uint64_t below(uint64_t bound) {
+    // Rejects the low values that would make the modulo biased
+    const uint64_t threshold = (0 - bound) % bound;
+    for (;;) {
+      const uint64_t r = next();
+      if (r >= threshold) return r % bound;
+    }
+  }
+
+  /** @brief Gets a number uniformly distributed in [0, 1). */
+  double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+ private:
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+  uint64_t m_state[4];
+};
+
+/**
+ * @brief Generator of random values of a B type.
+ *
+ * The type is compiled once, at construction, into a flat program with one
+ * step per distinct sub-type. Generators are immutable: one generator may be
+ * used by several threads, each with its own BRandom and BValueBatch.
+ *
+ * Types with finitely many values (BOOL, enumerated and abstract sets, and
+ * products, structs and power sets of these), up to 2^62 values, are drawn
+ * uniformly when Options::uniform is set. Other values are size-bounded:
+ * integers, reals and strings are drawn within the bounds of the options, and
+ * sets have at most Options::maxSetSize elements.
+ *
+ * @code
+ * BValueBatch batch;
+ * BRandom random(42);
+ * BValueGenerator::of(type)->fill(random, 4096, batch);
+ * for (size_t i = 0; i < batch.size(); ++i) run(batch[i]);
+ * @endcode
+ */
+class BValueGenerator {
+ public:
+  /** @brief Parameters of the distribution of the values. */
+  struct Options {
+    /** @brief Draws the values of finite types uniformly. */
+    bool uniform = true;
+    /** @brief Bounds of INTEGER values. */
+    int64_t minInteger = -1000;
+    int64_t maxInteger = 1000;
+    /** @brief Bounds of REAL and FLOAT values. */
+    double minReal = -1000.0;
+    double maxReal = 1000.0;
+    /** @brief Maximal number of elements of a set that is not drawn
+     * uniformly. */
+    uint32_t maxSetSize = 8;
+    /** @brief Maximal length of STRING values. */
+    uint32_t maxStringLength = 8;
+    /** @brief Number of elements of each abstract set. */
+    uint32_t abstractSetSize = 3;
+  };
+
+  /**
+   * @brief Compiles a generator for a type.
+   * @throw BTypeFactory::Exception if the type has no values (enumerated set
+   * without values, abstractSetSize 0) or the bounds are invalid
+   */
+  BValueGenerator(const std::shared_ptr<BType> &type, const Options &options);
+  /** @brief Compiles a generator for a type, with the default options. */
+  explicit BValueGenerator(const std::shared_ptr<BType> &type)
+      : BValueGenerator(type, Options()) {}
+
+  /**
+   * @brief Gets the generator of a type with the default options. Generators
+   * are compiled on first use and cached by type index.
+   */
+  static std::shared_ptr<const BValueGenerator> of(
+      const std::shared_ptr<BType> &type);
+
+  /** @brief Gets the type of the generated values. */
+  const std::shared_ptr<BType> &type() const { return m_type; }
+
+  /**
+   * @brief Gets the number of values of the type, if they are drawn
+   * uniformly; 0 otherwise.
+   */
+  uint64_t cardinality() const { return m_steps.back().cardinality; }
+
+  /**
+   * @brief Replaces the content of a batch with new random values.
+   * @param random the source of randomness
+   * @param count the number of values
+   * @param batch the batch; its storage is reused
+   */
+  void fill(BRandom &random, size_t count, BValueBatch &batch) const;
+
+ private:
+  // One step per distinct sub-type, sub-types first
+  struct Step {
+    const BType *type;
+    // Number of values if drawn uniformly, 0 otherwise
+    uint64_t cardinality;
+    // Range of m_stepChildren
+    uint32_t first;
+    uint32_t count;
+  };
+
+  // A tuple or set being made, whose members are not all made yet
+  struct Frame {
+    uint32_t step;
+    // Next member of a tuple, or next bit of the rank of a set
+    uint32_t next;
+    // Whether the value is the one of rank `rank`, rather than a random one
+    bool ranked;
+    uint64_t rank;
+    // Tuples: product of the cardinalities of the members from `next` on
+    uint64_t weight;
+    // Random sets: number of elements still to make
+    uint64_t left;
+    // Start of the members in the scratch stack
+    size_t start;
+  };
+
+  void compile(const BType &root);
+  uint32_t addStep(const BType &type, const std::vector<uint32_t> &children);
+  uint32_t open(uint32_t step, bool ranked, uint64_t rank, BRandom &random,
+                BValueBatch &batch, std::vector<Frame> &frames) const;
+  uint32_t generate(uint32_t root, BRandom &random, BValueBatch &batch,
+                    std::vector<Frame> &frames) const;
+  uint32_t scalar(uint32_t step, BRandom &random, BValueBatch &batch) const;
+  uint32_t makeSet(uint32_t step, size_t start, BValueBatch &batch) const;
+  static uint32_t makeNode(size_t start, BValueBatch &batch);
+  static uint32_t push(BValueBatch &batch, const BValueBatch::Cell &cell);
+
+  std::shared_ptr<BType> m_type;
+  Options m_options;
+  std::vector<Step> m_steps;
+  std::vector<uint32_t> m_stepChildren;
+};
+
+#endif  // BTYPE_VALUE_GENERATOR_H
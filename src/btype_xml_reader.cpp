@@ -16,16 +16,104 @@
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
-#include <functional>
 #include <vector>
 
 #include "btype.h"
+#include "btype_rich_types_info.h"
 #include "tinyxml2.h"
 
-void BTypeFactory::buildFromXML(const tinyxml2::XMLElement* root) {
+using richTypesInfo::Record;
+
+// Reads a reference to another RichType element
+static bool queryId(const tinyxml2::XMLElement* elem, const char* attribute,
+                    size_t nbTypes, size_t& id) {
+  int value = -1;
+  if (elem->QueryIntAttribute(attribute, &value) != tinyxml2::XML_SUCCESS ||
+      value < 0 || static_cast<size_t>(value) >= nbTypes) {
+    return false;
+  }
+  id = static_cast<size_t>(value);
+  return true;
+}
+
+// Decodes the content of a RichType element
+static Record decode(const tinyxml2::XMLElement* typeElem, size_t nbTypes) {
+  const tinyxml2::XMLElement* typeDefElem = typeElem->FirstChildElement();
+  if (!typeDefElem) {
+    throw BTypeFactory::Exception("Empty RichType element");
+  }
+  std::string elemName = typeDefElem->Name();
+  Record record;
+
+  if (elemName == "BOOL") {
+    record.kind = Record::Kind::BOOL;
+  } else if (elemName == "INTEGER") {
+    record.kind = Record::Kind::INTEGER;
+  } else if (elemName == "REAL") {
+    record.kind = Record::Kind::REAL;
+  } else if (elemName == "FLOAT") {
+    record.kind = Record::Kind::FLOAT;
+  } else if (elemName == "STRING") {
+    record.kind = Record::Kind::STRING;
+  } else if (elemName == "PowerSet") {
+    record.kind = Record::Kind::PowerSet;
+    record.args.resize(1);
+    if (!queryId(typeDefElem, "arg", nbTypes, record.args[0])) {
+      throw BTypeFactory::Exception("Invalid PowerSet arg reference");
+    }
+  } else if (elemName == "CartesianProduct") {
+    record.kind = Record::Kind::CartesianProduct;
+    record.args.resize(2);
+    if (!queryId(typeDefElem, "arg1", nbTypes, record.args[0]) ||
+        !queryId(typeDefElem, "arg2", nbTypes, record.args[1])) {
+      throw BTypeFactory::Exception("Invalid CartesianProduct arg references");
+    }
+  } else if (elemName == "AbstractSet") {
+    record.kind = Record::Kind::AbstractSet;
+    const char* name = typeDefElem->Attribute("name");
+    if (!name) {
+      throw BTypeFactory::Exception("Missing AbstractSet name attribute");
+    }
+    record.name = name;
+  } else if (elemName == "EnumeratedSet") {
+    record.kind = Record::Kind::EnumeratedSet;
+    const char* name = typeDefElem->Attribute("name");
+    if (!name) {
+      throw BTypeFactory::Exception("Missing EnumeratedSet name attribute");
+    }
+    record.name = name;
+    for (auto valueElem = typeDefElem->FirstChildElement("EnumeratedValue");
+         valueElem;
+         valueElem = valueElem->NextSiblingElement("EnumeratedValue")) {
+      const char* valueName = valueElem->Attribute("name");
+      if (!valueName) {
+        throw BTypeFactory::Exception(
+            "Missing EnumeratedValue name attribute");
+      }
+      record.labels.push_back(valueName);
+    }
+  } else if (elemName == "StructType") {
+    record.kind = Record::Kind::StructType;
+    for (auto fieldElem = typeDefElem->FirstChildElement("Field"); fieldElem;
+         fieldElem = fieldElem->NextSiblingElement("Field")) {
+      const char* fieldName = fieldElem->Attribute("name");
+      size_t fieldTypeId = 0;
+      if (!fieldName || !queryId(fieldElem, "type", nbTypes, fieldTypeId)) {
+        throw BTypeFactory::Exception("Invalid Struct field definition");
+      }
+      record.labels.push_back(fieldName);
+      record.args.push_back(fieldTypeId);
+    }
+  } else {
+    throw BTypeFactory::Exception("Unknown type element: " + elemName);
+  }
+  return record;
+}
+
+std::vector<std::shared_ptr<BType>> BTypeFactory::buildFromXML(
+    const tinyxml2::XMLElement* root, unsigned nbThreads) {
   std::vector<const tinyxml2::XMLElement*> richTypeElements;
-  std::vector<std::shared_ptr<BType>> types;
-  // First pass: create placeholder for all types to handle forward references
+  // First pass: collect all elements to handle forward references
   for (auto typeElem = root->FirstChildElement("RichType"); typeElem;
        typeElem = typeElem->NextSiblingElement("RichType")) {
     int id = -1;
@@ -37,108 +125,16 @@ void BTypeFactory::buildFromXML(const tinyxml2::XMLElement* root) {
       throw Exception("RichType indexing is not contiguous");
     }
     richTypeElements.push_back(typeElem);
-    types.push_back(nullptr);
   }
 
-  std::function<void(const size_t)> typeOfXmlElement;
-
-  typeOfXmlElement = [&](const size_t pos) -> void {
-    if (types.at(pos)) {
-      return;
-    }
-    const tinyxml2::XMLElement* typeElem = richTypeElements.at(pos);
-    const tinyxml2::XMLElement* typeDefElem = typeElem->FirstChildElement();
-    if (!typeDefElem) {
-      throw Exception("Empty RichType element");
-    }
-    std::string elemName = typeDefElem->Name();
-    std::shared_ptr<BType> type;
-
-    if (elemName == "BOOL") {
-      type = Boolean();
-    } else if (elemName == "INTEGER") {
-      type = Integer();
-    } else if (elemName == "REAL") {
-      type = Real();
-    } else if (elemName == "FLOAT") {
-      type = Float();
-    } else if (elemName == "STRING") {
-      type = String();
-    } else if (elemName == "PowerSet") {
-      int argId = -1;
-      if (typeDefElem->QueryIntAttribute("arg", &argId) !=
-              tinyxml2::XML_SUCCESS ||
-          argId < 0 || static_cast<size_t>(argId) >= types.size()) {
-        throw Exception("Invalid PowerSet arg reference");
-      }
-      typeOfXmlElement(argId);
-      type = PowerSet(types.at(argId));
-    } else if (elemName == "CartesianProduct") {
-      int arg1Id = -1, arg2Id = -1;
-      if (typeDefElem->QueryIntAttribute("arg1", &arg1Id) !=
-              tinyxml2::XML_SUCCESS ||
-          typeDefElem->QueryIntAttribute("arg2", &arg2Id) !=
-              tinyxml2::XML_SUCCESS ||
-          arg1Id < 0 || static_cast<size_t>(arg1Id) >= types.size() ||
-          arg2Id < 0 || static_cast<size_t>(arg2Id) >= types.size()) {
-        throw Exception("Invalid CartesianProduct arg references");
-      }
-      typeOfXmlElement(arg1Id);
-      typeOfXmlElement(arg2Id);
-      type = Product(types.at(arg1Id), types.at(arg2Id));
-    } else if (elemName == "AbstractSet") {
-      const char* name = typeDefElem->Attribute("name");
-      if (!name) {
-        throw Exception("Missing AbstractSet name attribute");
-      }
-      type = AbstractSet(name);
-    } else if (elemName == "EnumeratedSet") {
-      const char* name = typeDefElem->Attribute("name");
-      if (!name) {
-        throw Exception("Missing EnumeratedSet name attribute");
-      }
-      std::vector<std::string> values;
-      for (auto valueElem = typeDefElem->FirstChildElement("EnumeratedValue");
-           valueElem;
-           valueElem = valueElem->NextSiblingElement("EnumeratedValue")) {
-        const char* valueName = valueElem->Attribute("name");
-        if (!valueName) {
-          throw Exception("Missing EnumeratedValue name attribute");
-        }
-        values.push_back(valueName);
-      }
-      type = EnumeratedSet(name, values);
-    } else if (elemName == "StructType") {
-      std::vector<std::pair<std::string, std::shared_ptr<BType>>> fields;
-      for (auto fieldElem = typeDefElem->FirstChildElement("Field"); fieldElem;
-           fieldElem = fieldElem->NextSiblingElement("Field")) {
-        const char* fieldName = fieldElem->Attribute("name");
-        int fieldTypeId = -1;
-        if (!fieldName ||
-            fieldElem->QueryIntAttribute("type", &fieldTypeId) !=
-                tinyxml2::XML_SUCCESS ||
-            fieldTypeId < 0 ||
-            static_cast<size_t>(fieldTypeId) >= types.size()) {
-          throw Exception("Invalid Struct field definition");
-        }
-        typeOfXmlElement(fieldTypeId);
-        fields.emplace_back(fieldName, types.at(fieldTypeId));
-      }
-      type = Struct(fields);
-    } else {
-      throw Exception("Unknown type element: " + elemName);
-    }
-    types[pos] = type;
-  };
-
-  for (auto i = 0u; i < richTypeElements.size(); i++) {
-    typeOfXmlElement(i);
+  // Second pass: decode the elements, on the calling thread. tinyxml2 does
+  // not promise that reading a node does not write to it.
+  const size_t nbTypes = richTypeElements.size();
+  std::vector<Record> records(nbTypes);
+  for (size_t i = 0; i < nbTypes; ++i) {
+    records[i] = decode(richTypeElements[i], nbTypes);
   }
 
-  // Verify no gaps in the type vector
-  for (size_t i = 0; i < types.size(); ++i) {
-    if (!types[i]) {
-      throw Exception("Missing type definition for id " + std::to_string(i));
-    }
-  }
+  // Third pass: create the types, arguments first
+  return richTypesInfo::resolve(records, nbThreads);
 }
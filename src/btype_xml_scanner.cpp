@@ -0,0 +1,619 @@
+/* @file btype_xml_scanner.cpp
+   @brief Implementation file for the BTypeFactory::readXMLRichTypesInfo
+   method: a reader specialized for the RichTypesInfo schema.
+
+   The reader does not build a DOM. It scans the input for markup and quote
+   delimiters with SIMD instructions when available, recognizes element and
+   attribute names with perfect hash functions, and reads ids with
+   std::from_chars.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "btype.h"
+#include "btype_rich_types_info.h"
+
+using richTypesInfo::Record;
+
+namespace {
+
+/*
+ * Byte scanning
+ */
+
+inline bool isSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+#if defined(__SSE2__)
+inline unsigned firstBit(unsigned mask) {
+  return static_cast<unsigned>(__builtin_ctz(mask));
+}
+#endif
+
+// Returns the first byte in [p, end) that is not XML white space, or end.
+const char *skipSpace(const char *p, const char *end) {
+#if defined(__SSE2__)
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i cr = _mm_set1_epi8('\r');
+  while (end - p >= 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const __m128i spaces = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                     _mm_cmpeq_epi8(chunk, newline)),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, tab), _mm_cmpeq_epi8(chunk, cr)));
+    const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(spaces)) &
+                          0xFFFFu;
+    if (mask) return p + firstBit(mask);
+    p += 16;
+  }
+#endif
+  while (p < end && isSpace(*p)) ++p;
+  return p;
+}
+
+// Returns the first byte in [p, end) equal to a, b or c, or end.
+const char *findAny(const char *p, const char *end, char a, char b, char c) {
+#if defined(__SSE2__)
+  const __m128i va = _mm_set1_epi8(a);
+  const __m128i vb = _mm_set1_epi8(b);
+  const __m128i vc = _mm_set1_epi8(c);
+  while (end - p >= 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const __m128i hits =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, va),
+                                  _mm_cmpeq_epi8(chunk, vb)),
+                     _mm_cmpeq_epi8(chunk, vc));
+    const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+    if (mask) return p + firstBit(mask);
+    p += 16;
+  }
+#endif
+  while (p < end && *p != a && *p != b && *p != c) ++p;
+  return p;
+}
+
+/*
+ * Names of RichTypesInfo.xsd, recognized with perfect hash functions. The
+ * hash functions combine the length, first and last characters of a name;
+ * their constants have been chosen so that they have no collision on the
+ * names of the schema. A candidate name is then compared with the only name
+ * having the same hash.
+ */
+
+enum class Element : uint8_t {
+  RichTypesInfo,
+  RichType,
+  BOOL,
+  INTEGER,
+  REAL,
+  FLOAT,
+  STRING,
+  PowerSet,
+  CartesianProduct,
+  AbstractSet,
+  EnumeratedSet,
+  EnumeratedValue,
+  StructType,
+  Field,
+  Unknown
+};
+
+enum class Attribute : uint8_t { id, arg, arg1, arg2, name, type, Unknown };
+constexpr size_t nbAttributes = static_cast<size_t>(Attribute::Unknown);
+
+constexpr std::string_view elementNames[] = {
+    "RichTypesInfo", "RichType",         "BOOL",          "INTEGER",
+    "REAL",          "FLOAT",            "STRING",        "PowerSet",
+    "CartesianProduct", "AbstractSet",   "EnumeratedSet", "EnumeratedValue",
+    "StructType",    "Field"};
+
+constexpr std::string_view attributeNames[] = {"id",   "arg",  "arg1",
+                                               "arg2", "name", "type"};
+
+constexpr size_t elementHash(std::string_view name) {
+  return (name.size() + 7 * static_cast<unsigned char>(name.front()) +
+          static_cast<unsigned char>(name.back())) &
+         31;
+}
+
+constexpr size_t attributeHash(std::string_view name) {
+  return (2 * name.size() + 2 * static_cast<unsigned char>(name.front()) +
+          static_cast<unsigned char>(name.back())) &
+         7;
+}
+
+constexpr std::array<Element, 32> makeElementTable() {
+  std::array<Element, 32> table{};
+  for (auto &slot : table) slot = Element::Unknown;
+  for (size_t i = 0; i < std::size(elementNames); ++i)
+    table[elementHash(elementNames[i])] = static_cast<Element>(i);
+  return table;
+}
+
+constexpr std::array<Attribute, 8> makeAttributeTable() {
+  std::array<Attribute, 8> table{};
+  for (auto &slot : table) slot = Attribute::Unknown;
+  for (size_t i = 0; i < std::size(attributeNames); ++i)
+    table[attributeHash(attributeNames[i])] = static_cast<Attribute>(i);
+  return table;
+}
+
+constexpr std::array<Element, 32> elementTable = makeElementTable();
+constexpr std::array<Attribute, 8> attributeTable = makeAttributeTable();
+
+// Checks at compile time that the hash functions are perfect on the schema
+constexpr bool isPerfect() {
+  for (size_t i = 0; i < std::size(elementNames); ++i)
+    if (elementTable[elementHash(elementNames[i])] != static_cast<Element>(i))
+      return false;
+  for (size_t i = 0; i < std::size(attributeNames); ++i)
+    if (attributeTable[attributeHash(attributeNames[i])] !=
+        static_cast<Attribute>(i))
+      return false;
+  return true;
+}
+static_assert(isPerfect(), "collision in the RichTypesInfo name hashes");
+
+Element element(std::string_view name) {
+  if (name.empty()) return Element::Unknown;
+  const Element candidate = elementTable[elementHash(name)];
+  if (candidate == Element::Unknown ||
+      elementNames[static_cast<size_t>(candidate)] != name)
+    return Element::Unknown;
+  return candidate;
+}
+
+Attribute attribute(std::string_view name) {
+  if (name.empty()) return Attribute::Unknown;
+  const Attribute candidate = attributeTable[attributeHash(name)];
+  if (candidate == Attribute::Unknown ||
+      attributeNames[static_cast<size_t>(candidate)] != name)
+    return Attribute::Unknown;
+  return candidate;
+}
+
+/*
+ * Tokenizer
+ */
+
+/** @brief A start or end tag, with the values of the known attributes. */
+struct Tag {
+  Element element = Element::Unknown;
+  std::string_view name;
+  bool closing = false;      // </name>
+  bool selfClosing = false;  // <name/>
+  std::array<std::string_view, nbAttributes> values;
+  std::array<bool, nbAttributes> present;
+  // Storage of the attribute values that contain references or white space
+  std::array<std::string, nbAttributes> decoded;
+
+  bool has(Attribute a) const { return present[static_cast<size_t>(a)]; }
+  std::string_view value(Attribute a) const {
+    return values[static_cast<size_t>(a)];
+  }
+};
+
+class Scanner {
+ public:
+  explicit Scanner(std::string_view xml)
+      : m_begin{xml.data()}, m_p{xml.data()}, m_end{xml.data() + xml.size()} {}
+
+  std::vector<Record> document() {
+    if (m_end - m_p >= 3 && std::memcmp(m_p, "\xEF\xBB\xBF", 3) == 0)
+      m_p += 3;  // byte order mark
+    Tag tag;
+    if (!next(tag) || tag.closing || tag.element != Element::RichTypesInfo)
+      fail("Missing RichTypesInfo element");
+    if (!tag.selfClosing) {
+      for (inner(tag); !tag.closing; inner(tag)) {
+        if (tag.element != Element::RichType) unexpected(tag);
+        richType(tag);
+      }
+      expectEnd(tag, Element::RichTypesInfo);
+    }
+    if (next(tag)) fail("Unexpected content after RichTypesInfo element");
+    checkReferences();
+    return std::move(m_records);
+  }
+
+ private:
+  [[noreturn]] void fail(const std::string &msg) const {
+    throw BTypeFactory::Exception(
+        msg + " (offset " + std::to_string(m_p - m_begin) + ")");
+  }
+
+  [[noreturn]] void unexpected(const Tag &tag) const {
+    fail("Unexpected element " + std::string(tag.name));
+  }
+
+  bool startsWith(const char *prefix) const {
+    const size_t n = std::strlen(prefix);
+    return static_cast<size_t>(m_end - m_p) >= n &&
+           std::memcmp(m_p, prefix, n) == 0;
+  }
+
+  // Moves past the given delimiter, skipping everything before it
+  void skipPast(const char *delimiter, const char *what) {
+    const char first = delimiter[0];
+    for (;;) {
+      m_p = findAny(m_p, m_end, first, first, first);
+      if (m_p == m_end) fail(std::string("Unterminated ") + what);
+      if (startsWith(delimiter)) break;
+      ++m_p;
+    }
+    m_p += std::strlen(delimiter);
+  }
+
+  std::string_view name() {
+    const char *start = m_p;
+    while (m_p < m_end && !isSpace(*m_p) && *m_p != '/' && *m_p != '>' &&
+           *m_p != '=' && *m_p != '<' && *m_p != '"' && *m_p != '\'')
+      ++m_p;
+    if (m_p == start) fail("Missing name");
+    return std::string_view(start, m_p - start);
+  }
+
+  // Reads the next tag, skipping white space, comments and processing
+  // instructions. Returns false at the end of the input.
+  bool next(Tag &tag) {
+    for (;;) {
+      m_p = skipSpace(m_p, m_end);
+      if (m_p == m_end) return false;
+      if (*m_p != '<') fail("Unexpected text");
+      if (startsWith("<!--")) {
+        m_p += 4;
+        skipPast("-->", "comment");
+      } else if (startsWith("<?")) {
+        m_p += 2;
+        skipPast("?>", "processing instruction");
+      } else if (startsWith("<!DOCTYPE")) {
+        m_p = findAny(m_p, m_end, '>', '[', '[');
+        if (m_p == m_end || *m_p == '[')
+          fail("Unsupported document type declaration");
+        ++m_p;
+      } else if (startsWith("<!")) {
+        fail("Unexpected text");
+      } else {
+        break;
+      }
+    }
+    ++m_p;
+    tag.closing = m_p < m_end && *m_p == '/';
+    if (tag.closing) ++m_p;
+    tag.name = name();
+    tag.element = element(tag.name);
+    tag.selfClosing = false;
+    tag.present.fill(false);
+    for (;;) {
+      m_p = skipSpace(m_p, m_end);
+      if (m_p == m_end) fail("Unterminated tag " + std::string(tag.name));
+      if (*m_p == '>') {
+        ++m_p;
+        return true;
+      }
+      if (!tag.closing && *m_p == '/') {
+        if (m_end - m_p < 2 || m_p[1] != '>') fail("Malformed tag");
+        m_p += 2;
+        tag.selfClosing = true;
+        return true;
+      }
+      if (tag.closing) fail("Malformed end tag");
+      const char *attributeStart = m_p;
+      const Attribute a = attribute(name());
+      m_p = skipSpace(m_p, m_end);
+      if (m_p == m_end || *m_p != '=') fail("Missing '=' after attribute name");
+      m_p = skipSpace(m_p + 1, m_end);
+      if (m_p == m_end || (*m_p != '"' && *m_p != '\'')) {
+        fail("Missing attribute value");
+      }
+      const char quote = *m_p++;
+      const char *start = m_p;
+      m_p = findAny(m_p, m_end, quote, '&', '<');
+      std::string_view value(start, m_p - start);
+      const bool plain = m_p < m_end && *m_p == quote &&
+                         findAny(start, m_p, '\t', '\n', '\r') == m_p;
+      if (!plain) {
+        std::string &buffer = a == Attribute::Unknown
+                                  ? m_scratch
+                                  : tag.decoded[static_cast<size_t>(a)];
+        buffer.clear();
+        m_p = start;
+        decode(quote, buffer);
+        value = buffer;
+      } else {
+        ++m_p;
+      }
+      if (a == Attribute::Unknown) continue;
+      const size_t i = static_cast<size_t>(a);
+      if (tag.present[i]) {
+        m_p = attributeStart;
+        fail("Duplicate attribute " + std::string(attributeNames[i]));
+      }
+      tag.present[i] = true;
+      tag.values[i] = value;
+    }
+  }
+
+  // Decodes an attribute value containing references or white space other
+  // than ' ', up to the closing quote.
+  void decode(char quote, std::string &buffer) {
+    for (;;) {
+      if (m_p == m_end) fail("Unterminated attribute value");
+      const char c = *m_p;
+      if (c == quote) {
+        ++m_p;
+        break;
+      }
+      if (c == '<') fail("Unexpected '<' in attribute value");
+      if (c == '&') {
+        const char *semicolon = findAny(m_p, m_end, ';', quote, '<');
+        if (semicolon == m_end || *semicolon != ';')
+          fail("Malformed reference");
+        reference(std::string_view(m_p + 1, semicolon - m_p - 1), buffer);
+        m_p = semicolon + 1;
+      } else {
+        // attribute value normalization, after end-of-line handling: "\r\n"
+        // is a single line break
+        buffer.push_back(isSpace(c) ? ' ' : c);
+        ++m_p;
+        if (c == '\r' && m_p < m_end && *m_p == '\n') ++m_p;
+      }
+    }
+  }
+
+  void reference(std::string_view ref, std::string &buffer) {
+    if (ref == "lt") {
+      buffer.push_back('<');
+    } else if (ref == "gt") {
+      buffer.push_back('>');
+    } else if (ref == "amp") {
+      buffer.push_back('&');
+    } else if (ref == "quot") {
+      buffer.push_back('"');
+    } else if (ref == "apos") {
+      buffer.push_back('\'');
+    } else if (ref.size() > 1 && ref[0] == '#') {
+      uint32_t code = 0;
+      const bool hex = ref[1] == 'x';
+      const char *first = ref.data() + (hex ? 2 : 1);
+      const char *last = ref.data() + ref.size();
+      auto [ptr, ec] = std::from_chars(first, last, code, hex ? 16 : 10);
+      if (ec != std::errc() || ptr != last || first == last || code == 0 ||
+          code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))
+        fail("Invalid character reference");
+      // UTF-8 encoding
+      if (code < 0x80) {
+        buffer.push_back(static_cast<char>(code));
+      } else if (code < 0x800) {
+        buffer.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        buffer.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+      } else if (code < 0x10000) {
+        buffer.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        buffer.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        buffer.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+      } else {
+        buffer.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        buffer.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        buffer.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        buffer.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+      }
+    } else {
+      fail("Unknown entity " + std::string(ref));
+    }
+  }
+
+  // Reads a non-negative xs:integer attribute value
+  static bool id(const Tag &tag, Attribute a, size_t &result) {
+    if (!tag.has(a)) return false;
+    std::string_view value = tag.value(a);
+    while (!value.empty() && isSpace(value.front())) value.remove_prefix(1);
+    while (!value.empty() && isSpace(value.back())) value.remove_suffix(1);
+    if (!value.empty() && value.front() == '+') value.remove_prefix(1);
+    if (value.empty()) return false;
+    auto [ptr, ec] =
+        std::from_chars(value.data(), value.data() + value.size(), result);
+    return ec == std::errc() && ptr == value.data() + value.size() &&
+           result <= static_cast<size_t>(INT32_MAX);
+  }
+
+  // Reads the next tag inside an element
+  void inner(Tag &tag) {
+    if (!next(tag)) fail("Unexpected end of input");
+  }
+
+  void expectEnd(const Tag &tag, Element e) {
+    if (!tag.closing || tag.element != e) {
+      fail("Expected end of element " +
+           std::string(elementNames[static_cast<size_t>(e)]));
+    }
+  }
+
+  // Reads the end of an element that has no content
+  void empty(const Tag &start) {
+    if (start.selfClosing) return;
+    Tag tag;
+    inner(tag);
+    if (!tag.closing) unexpected(tag);
+    expectEnd(tag, start.element);
+  }
+
+  void richType(const Tag &start) {
+    size_t value = 0;
+    if (!id(start, Attribute::id, value)) {
+      fail("Invalid or missing id attribute");
+    }
+    if (value != m_records.size()) {
+      fail("RichType indexing is not contiguous");
+    }
+    if (start.selfClosing) fail("Empty RichType element");
+    Tag tag;
+    inner(tag);
+    if (tag.closing) fail("Empty RichType element");
+    m_records.push_back(typeDefinition(tag));
+    inner(tag);
+    if (!tag.closing) unexpected(tag);
+    expectEnd(tag, Element::RichType);
+  }
+
+  Record typeDefinition(const Tag &start) {
+    Record record;
+    switch (start.element) {
+      case Element::BOOL:
+        record.kind = Record::Kind::BOOL;
+        empty(start);
+        break;
+      case Element::INTEGER:
+        record.kind = Record::Kind::INTEGER;
+        empty(start);
+        break;
+      case Element::REAL:
+        record.kind = Record::Kind::REAL;
+        empty(start);
+        break;
+      case Element::FLOAT:
+        record.kind = Record::Kind::FLOAT;
+        empty(start);
+        break;
+      case Element::STRING:
+        record.kind = Record::Kind::STRING;
+        empty(start);
+        break;
+      case Element::PowerSet:
+        record.kind = Record::Kind::PowerSet;
+        record.args.resize(1);
+        if (!id(start, Attribute::arg, record.args[0])) {
+          fail("Invalid PowerSet arg reference");
+        }
+        empty(start);
+        break;
+      case Element::CartesianProduct:
+        record.kind = Record::Kind::CartesianProduct;
+        record.args.resize(2);
+        if (!id(start, Attribute::arg1, record.args[0]) ||
+            !id(start, Attribute::arg2, record.args[1])) {
+          fail("Invalid CartesianProduct arg references");
+        }
+        empty(start);
+        break;
+      case Element::AbstractSet:
+        record.kind = Record::Kind::AbstractSet;
+        if (!start.has(Attribute::name)) {
+          fail("Missing AbstractSet name attribute");
+        }
+        record.name = start.value(Attribute::name);
+        empty(start);
+        break;
+      case Element::EnumeratedSet:
+        record.kind = Record::Kind::EnumeratedSet;
+        if (!start.has(Attribute::name)) {
+          fail("Missing EnumeratedSet name attribute");
+        }
+        record.name = start.value(Attribute::name);
+        if (!start.selfClosing) {
+          Tag tag;
+          for (inner(tag); !tag.closing; inner(tag)) {
+            if (tag.element != Element::EnumeratedValue) unexpected(tag);
+            if (!tag.has(Attribute::name)) {
+              fail("Missing EnumeratedValue name attribute");
+            }
+            record.labels.emplace_back(tag.value(Attribute::name));
+            empty(tag);
+          }
+          expectEnd(tag, Element::EnumeratedSet);
+        }
+        break;
+      case Element::StructType:
+        record.kind = Record::Kind::StructType;
+        if (!start.selfClosing) {
+          Tag tag;
+          for (inner(tag); !tag.closing; inner(tag)) {
+            if (tag.element != Element::Field) unexpected(tag);
+            size_t fieldTypeId = 0;
+            if (!tag.has(Attribute::name) ||
+                !id(tag, Attribute::type, fieldTypeId)) {
+              fail("Invalid Struct field definition");
+            }
+            record.labels.emplace_back(tag.value(Attribute::name));
+            record.args.push_back(fieldTypeId);
+            empty(tag);
+          }
+          expectEnd(tag, Element::StructType);
+        }
+        break;
+      case Element::Unknown:
+        fail("Unknown type element: " + std::string(start.name));
+      default:
+        unexpected(start);
+    }
+    return record;
+  }
+
+  // References may point forward: they are checked once all ids are known
+  void checkReferences() const {
+    const size_t nbTypes = m_records.size();
+    for (const auto &record : m_records) {
+      for (size_t arg : record.args) {
+        if (arg < nbTypes) continue;
+        switch (record.kind) {
+          case Record::Kind::PowerSet:
+            throw BTypeFactory::Exception("Invalid PowerSet arg reference");
+          case Record::Kind::CartesianProduct:
+            throw BTypeFactory::Exception(
+                "Invalid CartesianProduct arg references");
+          default:
+            throw BTypeFactory::Exception("Invalid Struct field definition");
+        }
+      }
+    }
+  }
+
+  const char *const m_begin;
+  const char *m_p;
+  const char *const m_end;
+  std::vector<Record> m_records;
+  std::string m_scratch;
+};
+
+}  // namespace
+
+namespace richTypesInfo {
+
+std::vector<Record> scan(std::string_view xml) {
+  return Scanner(xml).document();
+}
+
+}  // namespace richTypesInfo
+
+std::vector<std::shared_ptr<BType>> BTypeFactory::readXMLRichTypesInfo(
+    std::string_view xml, unsigned nbThreads) {
+  return richTypesInfo::resolve(richTypesInfo::scan(xml), nbThreads);
+}
@@ -27,6 +27,32 @@
 #include "btype.h"
 #include "btype_fmt.h"
 
+// Escapes the characters that may not appear as such in an attribute value
+static std::string escape(const std::string &value) {
+  if (value.find_first_of("&<>\"") == std::string::npos) return value;
+  std::string result;
+  for (char c : value) {
+    switch (c) {
+      case '&':
+        result += "&amp;";
+        break;
+      case '<':
+        result += "&lt;";
+        break;
+      case '>':
+        result += "&gt;";
+        break;
+      case '"':
+        result += "&quot;";
+        break;
+      default:
+        result.push_back(c);
+        break;
+    }
+  }
+  return result;
+}
+
 void BTypeFactory::writeXMLRichTypesInfo(std::ostream &os) {
   std::size_t nbTypes = BTypeFactory::size();
   os << "<RichTypesInfo>\n";
@@ -89,8 +115,8 @@ void BTypeFactory::writeXMLRichTypesInfo(std::ostream &os) {
           <xs:attribute name="name" type="xs:string"/>
           </xs:complexType>
         */
-        os << "    <AbstractSet name=\"" << type->toAbstractSetType()->getName()
-           << "\"/>\n";
+        os << "    <AbstractSet name=\""
+           << escape(type->toAbstractSetType()->getName()) << "\"/>\n";
         break;
       case BType::Kind::EnumeratedSet:
         /*
@@ -102,7 +128,7 @@ void BTypeFactory::writeXMLRichTypesInfo(std::ostream &os) {
           </xs:complexType>
         */
         os << "    <EnumeratedSet name=\""
-           << type->toEnumeratedSetType()->getName() << "\">\n";
+           << escape(type->toEnumeratedSetType()->getName()) << "\">\n";
         for (const auto &value :
              type->toEnumeratedSetType()
                  ->getValues()) {  // std::vector<std::string>
@@ -111,7 +137,7 @@ void BTypeFactory::writeXMLRichTypesInfo(std::ostream &os) {
             <xs:attribute name="name" type="xs:string"/>
             </xs:complexType>
           */
-          os << "      <EnumeratedValue name=\"" << value << "\"/>\n";
+          os << "      <EnumeratedValue name=\"" << escape(value) << "\"/>\n";
         }
         os << "    </EnumeratedSet>\n";
         break;
@@ -133,7 +159,7 @@ void BTypeFactory::writeXMLRichTypesInfo(std::ostream &os) {
             <xs:attribute name="type" type="xs:integer"/>
             </xs:complexType>
           */
-          os << "      <Field name=\"" << field.first << "\" type=\""
+          os << "      <Field name=\"" << escape(field.first) << "\" type=\""
              << field.second->index() << "\"/>\n";
         }
         os << "    </StructType>\n";
@@ -0,0 +1,164 @@
+/* @file btype_artifact_cache_tests.cpp
+   @brief Unit tests for the BTypeArtifactCache class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "btype.h"
+#include "btype_artifact_cache.h"
+
+class BTypeArtifactCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override { std::remove(path); }
+  void TearDown() override { std::remove(path); }
+
+  // Appends raw bytes to the cache file
+  void appendBytes(const std::string &bytes) {
+    std::FILE *file = std::fopen(path, "ab");
+    ASSERT_NE(file, nullptr);
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+  }
+
+  const char *path = "btype_artifact_cache_tests.cache";
+};
+
+TEST_F(BTypeArtifactCacheTest, Fingerprint) {
+  using Cache = BTypeArtifactCache;
+  auto intType = BTypeFactory::Integer();
+  auto boolType = BTypeFactory::Boolean();
+  auto relation =
+      BTypeFactory::PowerSet(BTypeFactory::Product(intType, boolType));
+  auto colors = BTypeFactory::EnumeratedSet("Colors", {"Red", "Green"});
+  auto fields = BTypeFactory::Struct({{"x", intType}, {"y", boolType}});
+
+  EXPECT_EQ(Cache::fingerprint(*relation), Cache::fingerprint(*relation));
+  EXPECT_NE(Cache::fingerprint(*intType), Cache::fingerprint(*boolType));
+  EXPECT_NE(Cache::fingerprint(*BTypeFactory::Product(intType, boolType)),
+            Cache::fingerprint(*BTypeFactory::Product(boolType, intType)));
+  EXPECT_NE(Cache::fingerprint(*fields),
+            Cache::fingerprint(
+                *BTypeFactory::Struct({{"x", intType}, {"z", boolType}})));
+  EXPECT_NE(Cache::fingerprint(*colors),
+            Cache::fingerprint(*BTypeFactory::AbstractSet("Colors")));
+
+  // Fingerprints are stable across processes and builds
+  const auto fingerprint = Cache::fingerprint(*relation);
+  EXPECT_EQ(fingerprint.high, 0x803bc3abd5052033ULL);
+  EXPECT_EQ(fingerprint.low, 0xce2e0e5466947b52ULL);
+}
+
+TEST_F(BTypeArtifactCacheTest, Persistence) {
+  auto type = BTypeFactory::PowerSet(BTypeFactory::String());
+  auto other = BTypeFactory::PowerSet(BTypeFactory::Real());
+  {
+    BTypeArtifactCache cache(path);
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_FALSE(cache.find(*type, "smt", 1));
+    EXPECT_EQ(cache.insert(*type, "smt", 1, "(Set String)"), "(Set String)");
+    cache.insert(*type, "smt", 2, "(Array String Bool)");
+    cache.insert(*type, "c", 1, std::string("char **\0", 8));
+    cache.insert(*other, "smt", 1, "(Set Real)");
+    cache.insert(*other, "smt", 1, "(Set Real2)");
+    EXPECT_EQ(*cache.find(*other, "smt", 1), "(Set Real2)");
+    EXPECT_EQ(cache.size(), 4u);
+  }
+  BTypeArtifactCache cache(path);
+  EXPECT_EQ(cache.size(), 4u);
+  EXPECT_EQ(*cache.find(*type, "smt", 1), "(Set String)");
+  EXPECT_EQ(*cache.find(*type, "smt", 2), "(Array String Bool)");
+  EXPECT_EQ(*cache.find(*type, "c", 1), std::string("char **\0", 8));
+  EXPECT_EQ(*cache.find(*other, "smt", 1), "(Set Real2)");
+  EXPECT_FALSE(cache.find(*other, "c", 1));
+  EXPECT_FALSE(cache.find(*other, "smt", 3));
+}
+
+TEST_F(BTypeArtifactCacheTest, GetOrCompute) {
+  auto type = BTypeFactory::Product(BTypeFactory::Integer(),
+                                    BTypeFactory::String());
+  std::atomic<int> computed{0};
+  auto compute = [&] {
+    ++computed;
+    return std::string("layout");
+  };
+  {
+    BTypeArtifactCache cache(path);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([&] {
+        for (int k = 0; k < 100; ++k)
+          EXPECT_EQ(cache.getOrCompute(*type, "layout", 1, compute), "layout");
+      });
+    }
+    for (auto &thread : threads) thread.join();
+    EXPECT_EQ(cache.size(), 1u);
+  }
+  const int before = computed;
+  BTypeArtifactCache cache(path);
+  EXPECT_EQ(cache.getOrCompute(*type, "layout", 1, compute), "layout");
+  EXPECT_EQ(computed, before);
+}
+
+TEST_F(BTypeArtifactCacheTest, TornRecord) {
+  auto type = BTypeFactory::PowerSet(BTypeFactory::Boolean());
+  {
+    BTypeArtifactCache cache(path);
+    cache.insert(*type, "a", 1, "first");
+  }
+  // The beginning of a record, as left by a crash
+  appendBytes(std::string("BYTR\1\0\0\0garbage", 15));
+  {
+    BTypeArtifactCache cache(path);
+    EXPECT_EQ(cache.size(), 1u);
+    cache.insert(*type, "b", 1, "second");
+  }
+  BTypeArtifactCache cache(path);
+  EXPECT_EQ(cache.size(), 2u);
+  EXPECT_EQ(*cache.find(*type, "a", 1), "first");
+  EXPECT_EQ(*cache.find(*type, "b", 1), "second");
+}
+
+TEST_F(BTypeArtifactCacheTest, Refresh) {
+  auto type = BTypeFactory::PowerSet(BTypeFactory::Float());
+  BTypeArtifactCache reader(path);
+  BTypeArtifactCache writer(path);
+  const std::string big(10000, 'x');
+  writer.insert(*type, "big", 1, big);
+  EXPECT_FALSE(reader.find(*type, "big", 1));
+  reader.refresh();
+  EXPECT_EQ(*reader.find(*type, "big", 1), big);
+  writer.insert(*type, "small", 1, "y");
+  reader.refresh();
+  EXPECT_EQ(*reader.find(*type, "small", 1), "y");
+  EXPECT_EQ(*reader.find(*type, "big", 1), big);
+}
+
+TEST_F(BTypeArtifactCacheTest, NotACacheFile) {
+  appendBytes("this is not a cache file");
+  EXPECT_THROW(BTypeArtifactCache cache(path), BTypeFactory::Exception);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,123 @@
+/* @file btype_audit_tests.cpp
+   @brief Unit tests for the BTypeAudit class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "btype.h"
+#include "btype_audit.h"
+#include "btype_staging.h"
+
+class BTypeAuditTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto intType = BTypeFactory::Integer();
+    auto boolType = BTypeFactory::Boolean();
+    auto t = BTypeFactory::Product(intType, boolType);
+    auto colors = BTypeFactory::EnumeratedSet("Colors", {"Red", "Green"});
+    for (int i = 0; i < 3000; ++i) {
+      t = BTypeFactory::PowerSet(BTypeFactory::Product(t, colors));
+      if (i % 10 == 0) {
+        BTypeFactory::Struct({{"z" + std::to_string(i), t},
+                              {"a", BTypeFactory::AbstractSet("S")},
+                              {"m", BTypeFactory::String()}});
+      }
+    }
+    intType->hash();
+    t->toPowerType()->m_content->hash();
+  }
+};
+
+TEST_F(BTypeAuditTest, ConsistentTable) {
+  for (unsigned nbThreads : {1u, 4u}) {
+    BTypeAudit audit(nbThreads);
+    EXPECT_EQ(audit.size(), BTypeFactory::size());
+    EXPECT_TRUE(audit.run().empty());
+    EXPECT_TRUE(audit.run(100, 200).empty());
+    EXPECT_TRUE(audit.run(audit.size(), audit.size() + 10).empty());
+  }
+}
+
+TEST_F(BTypeAuditTest, AuditWhileCreating) {
+  std::thread writer([] {
+    auto t = BTypeFactory::Real();
+    for (int i = 0; i < 2000; ++i) t = BTypeFactory::PowerSet(t);
+  });
+  for (int round = 0; round < 5; ++round) {
+    BTypeAudit audit(2);
+    EXPECT_TRUE(audit.run().empty());
+  }
+  writer.join();
+}
+
+TEST_F(BTypeAuditTest, PermutedSnapshot) {
+  std::vector<std::shared_ptr<BType>> types;
+  for (size_t i = 0; i < BTypeFactory::size(); ++i)
+    types.push_back(BTypeFactory::at(i));
+  // Position 2 is a product of the types at positions 0 and 1
+  ASSERT_EQ(types[2]->getKind(), BType::Kind::ProductType);
+  std::swap(types[0], types[2]);
+
+  const auto violations = BTypeAudit(types, 3).run();
+  ASSERT_FALSE(violations.empty());
+  EXPECT_EQ(violations[0].index, 0);
+  EXPECT_EQ(violations[0].check, BTypeAudit::Check::Index);
+  EXPECT_EQ(violations[1].index, 0);
+  EXPECT_EQ(violations[1].check, BTypeAudit::Check::ChildOrder);
+  // The parent of the moved product, at position 4, is reported as well
+  for (const auto &violation : violations) {
+    EXPECT_LE(violation.index, 4) << violation.message;
+    EXPECT_NE(violation.check, BTypeAudit::Check::Duplicate);
+  }
+  // The range of a run limits the report
+  EXPECT_TRUE(BTypeAudit(types, 1).run(5).empty());
+}
+
+TEST_F(BTypeAuditTest, UnregisteredDuplicate) {
+  // A staged type has the structure of a type created afterwards in the
+  // table, without being it
+  BTypeStaging staging;
+  auto product = staging.Product(BTypeFactory::Boolean(),
+                                 BTypeFactory::Integer());
+  ASSERT_TRUE(BTypeStaging::isStaged(*product));
+  auto committed =
+      BTypeFactory::Product(BTypeFactory::Boolean(), BTypeFactory::Integer());
+  std::vector<std::shared_ptr<BType>> types;
+  for (size_t i = 0; i < 3; ++i) types.push_back(BTypeFactory::at(i));
+  types.push_back(product);
+
+  const auto violations = BTypeAudit(types, 1).run();
+  ASSERT_EQ(violations.size(), 2);
+  EXPECT_EQ(violations[0].check, BTypeAudit::Check::Index);
+  EXPECT_EQ(violations[1].check, BTypeAudit::Check::Duplicate);
+  EXPECT_EQ(violations[1].index, 3);
+  EXPECT_EQ(violations[1].message, "Same structure as the type with index " +
+                                        std::to_string(committed->index()));
+
+  auto set = staging.AbstractSet("NotCommitted");
+  const auto unregistered = BTypeAudit({set}, 1).run();
+  ASSERT_EQ(unregistered.size(), 2);
+  EXPECT_EQ(unregistered[1].message, "Structure not registered in the factory");
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
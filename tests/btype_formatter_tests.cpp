@@ -137,6 +137,59 @@ TEST_F(BTypeFmtTest, FormatterEdgeCases) {
   EXPECT_EQ(fmt::format("{}", specialSet), "Set@#$%");
 }
 
+TEST_F(BTypeFmtTest, SharedFormatting) {
+  auto pair =
+      BTypeFactory::Product(BTypeFactory::Integer(), BTypeFactory::Boolean());
+  auto power = BTypeFactory::PowerSet(BTypeFactory::Product(pair, pair));
+  EXPECT_EQ(fmt::format("{}", BTypeSharedFormat{power}),
+            fmt::format("let t{} = (INTEGER × BOOLEAN) in ℙ((t{} × t{}))",
+                        pair->index(), pair->index(), pair->index()));
+
+  // Types without sharing, or sharing below the threshold, print as trees
+  EXPECT_EQ(fmt::format("{}", BTypeSharedFormat{pair}),
+            fmt::format("{}", pair));
+  EXPECT_EQ(fmt::format("{}", BTypeSharedFormat{power, 4}),
+            fmt::format("{}", power));
+
+  std::shared_ptr<BType> nullType;
+  EXPECT_EQ(fmt::format("{}", BTypeSharedFormat{nullType}), "nullptr");
+}
+
+TEST_F(BTypeFmtTest, SharedFormattingIsLinear) {
+  // Each level doubles the tree size, but adds a single binding
+  auto type =
+      BTypeFactory::Product(BTypeFactory::String(), BTypeFactory::Float());
+  const size_t depth = 16;
+  for (size_t i = 0; i < depth; ++i) {
+    type = BTypeFactory::Product(type, type);
+  }
+  type = BTypeFactory::Struct({{"field1s", type}, {"field2s", type}});
+  std::string result = fmt::format("{}", BTypeSharedFormat{type});
+  EXPECT_LT(result.size(), 64 * depth);
+  auto field = type->toStructType()->m_fields[0].second;
+  std::string suffix = fmt::format(" in struct({{field1s: t{}, field2s: t{}}})",
+                                   field->index(), field->index());
+  ASSERT_GT(result.size(), suffix.size());
+  EXPECT_EQ(result.substr(result.size() - suffix.size()), suffix);
+}
+
+TEST_F(BTypeFmtTest, SharedFormattingOfDeepTypes) {
+  // Deeper than the thread stack would allow for a recursive printer
+  const size_t depth = 100000;
+  auto type = BTypeFactory::Integer();
+  for (size_t i = 0; i < depth; ++i) type = BTypeFactory::PowerSet(type);
+  std::string expected;
+  for (size_t i = 0; i < depth; ++i) expected += "ℙ(";
+  expected += "INTEGER";
+  expected.append(depth, ')');
+  EXPECT_EQ(fmt::format("{}", BTypeSharedFormat{type}), expected);
+
+  auto pair = BTypeFactory::Product(type, type);
+  EXPECT_EQ(fmt::format("{}", BTypeSharedFormat{pair}),
+            fmt::format("let t{} = {} in (t{} × t{})", type->index(),
+                        expected, type->index(), type->index()));
+}
+
 // main function
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
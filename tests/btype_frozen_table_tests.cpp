@@ -0,0 +1,169 @@
+/* @file btype_frozen_table_tests.cpp
+   @brief Unit tests for the BTypeFrozenTable and BTypeReplicatedTable
+   classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "btype.h"
+#include "btype_frozen_table.h"
+#include "btype_numa.h"
+
+class BTypeFrozenTableTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    intType = BTypeFactory::Integer();
+    boolType = BTypeFactory::Boolean();
+    product = BTypeFactory::Product(intType, boolType);
+    power = BTypeFactory::PowerSet(product);
+    abstractSet = BTypeFactory::AbstractSet("Frozen");
+    enumSet = BTypeFactory::EnumeratedSet("Colors", {"Red", "Green"});
+    record = BTypeFactory::Struct({{"b", power}, {"a", enumSet}});
+  }
+
+  // Checks that a table holds the types created in SetUp
+  void check(const BTypeFrozenTable &table) {
+    ASSERT_EQ(table.size(), BTypeFactory::size());
+    for (uint32_t i = 0; i < table.size(); ++i) {
+      EXPECT_EQ(table.at(i), BTypeFactory::at(i));
+      EXPECT_EQ(&table.node(i), BTypeFactory::at(i).get());
+      EXPECT_EQ(table.kind(i), BTypeFactory::at(i)->getKind());
+    }
+    const auto p = static_cast<uint32_t>(product->index());
+    ASSERT_EQ(table.arity(p), 2);
+    EXPECT_EQ(table.child(p, 0), intType->index());
+    EXPECT_EQ(table.child(p, 1), boolType->index());
+    EXPECT_EQ(table.arity(static_cast<uint32_t>(intType->index())), 0);
+
+    const auto e = static_cast<uint32_t>(enumSet->index());
+    EXPECT_EQ(table.name(e), "Colors");
+    ASSERT_EQ(table.nbLabels(e), 2);
+    EXPECT_EQ(table.label(e, 0), "Red");
+    EXPECT_EQ(table.label(e, 1), "Green");
+
+    const auto r = static_cast<uint32_t>(record->index());
+    EXPECT_EQ(table.name(r), "");
+    ASSERT_EQ(table.nbLabels(r), 2);
+    EXPECT_EQ(table.label(r, 0), "a");
+    EXPECT_EQ(table.label(r, 1), "b");
+    EXPECT_EQ(table.child(r, 0), e);
+
+    EXPECT_EQ(table.findProduct(static_cast<uint32_t>(intType->index()),
+                                static_cast<uint32_t>(boolType->index())),
+              p);
+    EXPECT_EQ(table.findProduct(static_cast<uint32_t>(boolType->index()),
+                                static_cast<uint32_t>(intType->index())),
+              BTypeFrozenTable::npos);
+    EXPECT_EQ(table.findPowerSet(p), power->index());
+    EXPECT_EQ(table.findNamed("Frozen"), abstractSet->index());
+    EXPECT_EQ(table.findNamed("Colors"), e);
+    EXPECT_EQ(table.findNamed("Red"), BTypeFrozenTable::npos);
+    EXPECT_EQ(table.findStruct({{"b", static_cast<uint32_t>(power->index())},
+                                {"a", e}}),
+              r);
+    EXPECT_EQ(table.findStruct({{"b", p}, {"a", e}}), BTypeFrozenTable::npos);
+  }
+
+  std::shared_ptr<BType> intType, boolType, product, power, abstractSet,
+      enumSet, record;
+};
+
+TEST_F(BTypeFrozenTableTest, Snapshot) {
+  BTypeFrozenTable table;
+  check(table);
+
+  // Later types are not in the snapshot
+  auto later = BTypeFactory::PowerSet(power);
+  EXPECT_EQ(table.size(), later->index());
+  EXPECT_EQ(table.findPowerSet(static_cast<uint32_t>(power->index())),
+            BTypeFrozenTable::npos);
+}
+
+TEST_F(BTypeFrozenTableTest, Copy) {
+  BTypeFrozenTable table;
+  BTypeFrozenTable copy(table);
+  EXPECT_EQ(copy.bytes(), table.bytes());
+  EXPECT_NE(copy.name(static_cast<uint32_t>(enumSet->index())).data(),
+            table.name(static_cast<uint32_t>(enumSet->index())).data());
+  check(copy);
+}
+
+TEST_F(BTypeFrozenTableTest, ManyTypes) {
+  std::vector<std::shared_ptr<BType>> types{intType};
+  for (int i = 0; i < 2000; ++i) {
+    types.push_back(BTypeFactory::Product(types.back(), boolType));
+    types.push_back(BTypeFactory::PowerSet(types.back()));
+  }
+  BTypeFrozenTable table;
+  for (size_t i = 1; i < types.size(); i += 2) {
+    const auto lhs = static_cast<uint32_t>(types[i - 1]->index());
+    EXPECT_EQ(table.findProduct(lhs, static_cast<uint32_t>(boolType->index())),
+              types[i]->index());
+    EXPECT_EQ(table.findPowerSet(static_cast<uint32_t>(types[i]->index())),
+              types[i + 1]->index());
+  }
+}
+
+TEST_F(BTypeFrozenTableTest, Topology) {
+  const auto &nodes = btypeNuma::nodes();
+  ASSERT_FALSE(nodes.empty());
+  EXPECT_LT(btypeNuma::currentNode(), nodes.size());
+  bool ran = false;
+  btypeNuma::runOnNode(0, [&] { ran = true; });
+  EXPECT_TRUE(ran);
+  EXPECT_THROW(btypeNuma::runOnNode(0, [] { throw std::runtime_error(""); }),
+               std::runtime_error);
+}
+
+TEST_F(BTypeFrozenTableTest, Replicas) {
+  // One copy per node by default
+  BTypeReplicatedTable table;
+  EXPECT_EQ(table.nbReplicas(), btypeNuma::nodes().size());
+  check(table.local());
+
+  // More copies than nodes, so that replication is exercised on any machine
+  BTypeReplicatedTable replicated(3);
+  ASSERT_EQ(replicated.nbReplicas(), 3);
+  for (unsigned k = 0; k < 3; ++k) {
+    check(replicated.replica(k));
+    for (unsigned l = 0; l < k; ++l) {
+      EXPECT_NE(&replicated.replica(k), &replicated.replica(l));
+    }
+  }
+
+  std::atomic<size_t> found{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      const BTypeFrozenTable &local = replicated.local();
+      if (local.findNamed("Colors") == enumSet->index()) ++found;
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  EXPECT_EQ(found, 4);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,157 @@
+/* @file btype_hash_cons_tests.cpp
+   @brief Unit tests for the HashConsTable class template.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "btype.h"
+#include "btype_hash_cons.h"
+
+// A client tree: integer expressions with constants and sums
+struct Expr {
+  int value;
+  std::shared_ptr<Expr> lhs, rhs;
+  size_t index = SIZE_MAX;
+};
+
+using SumKey = std::pair<const Expr *, const Expr *>;
+
+struct SumHash {
+  size_t operator()(const SumKey &key) const {
+    return std::hash<const Expr *>{}(key.first) * 31 +
+           std::hash<const Expr *>{}(key.second);
+  }
+};
+
+class ExprFactory {
+ public:
+  std::shared_ptr<Expr> constant(int value) {
+    return m_constants.intern(value, [&] {
+      return std::make_shared<Expr>(Expr{value, nullptr, nullptr});
+    });
+  }
+  std::shared_ptr<Expr> sum(const std::shared_ptr<Expr> &lhs,
+                            const std::shared_ptr<Expr> &rhs) {
+    return m_sums.intern({lhs.get(), rhs.get()}, [&] {
+      return std::make_shared<Expr>(Expr{0, lhs, rhs});
+    });
+  }
+  size_t size() const { return m_size; }
+
+  // Indices follow creation order. The counter is shared by two tables, each
+  // with its own lock, hence atomic.
+  std::atomic<size_t> m_size{0};
+  HashConsTable<int, Expr>::OnCreate m_onCreate =
+      [this](const std::shared_ptr<Expr> &e) { e->index = m_size++; };
+  HashConsTable<int, Expr> m_constants{m_onCreate, true};
+  HashConsTable<SumKey, Expr, SumHash> m_sums{m_onCreate, true};
+};
+
+class HashConsTableTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+};
+
+TEST_F(HashConsTableTest, MaximalSharing) {
+  ExprFactory f;
+  auto one = f.constant(1);
+  auto two = f.constant(2);
+  EXPECT_EQ(f.constant(1), one);
+  auto a = f.sum(one, two);
+  auto b = f.sum(f.constant(1), f.constant(2));
+  EXPECT_EQ(a, b);
+  EXPECT_NE(f.sum(two, one), a);
+  EXPECT_EQ(f.size(), 4);
+  EXPECT_EQ(one->index, 0);
+  EXPECT_EQ(two->index, 1);
+  EXPECT_EQ(a->index, 2);
+
+  EXPECT_EQ(f.m_sums.find({one.get(), two.get()}), a);
+  EXPECT_EQ(f.m_sums.find({a.get(), a.get()}), nullptr);
+  EXPECT_EQ(f.m_sums.size(), 2);
+
+  const auto stats = f.m_constants.stats();
+  EXPECT_EQ(stats.size, 2);
+  EXPECT_EQ(stats.creations, 2);
+  EXPECT_EQ(stats.lookups, 5);
+  EXPECT_GE(stats.buckets, 2);
+
+  size_t visited = 0;
+  f.m_constants.forEach(
+      [&](int key, const std::shared_ptr<Expr> &e) {
+        EXPECT_EQ(key, e->value);
+        ++visited;
+      });
+  EXPECT_EQ(visited, 2);
+}
+
+TEST_F(HashConsTableTest, Freeze) {
+  ExprFactory f;
+  auto one = f.constant(1);
+  f.m_constants.freeze();
+  EXPECT_TRUE(f.m_constants.frozen());
+  EXPECT_EQ(f.constant(1), one);
+  EXPECT_EQ(f.m_constants.find(1), one);
+  EXPECT_THROW(f.constant(2), HashConsError);
+  EXPECT_EQ(f.m_constants.size(), 1);
+  // Other tables are not affected
+  EXPECT_NE(f.sum(one, one), nullptr);
+}
+
+TEST_F(HashConsTableTest, ConcurrentInterning) {
+  ExprFactory f;
+  const int nbThreads = 8;
+  std::vector<std::vector<std::shared_ptr<Expr>>> results(nbThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nbThreads; ++t) {
+    threads.emplace_back([&, t] {
+      // All threads build the same chains of sums
+      auto e = f.constant(0);
+      for (int i = 1; i < 500; ++i) {
+        e = f.sum(e, f.constant(i % 7));
+        results[t].push_back(e);
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  for (int t = 1; t < nbThreads; ++t) EXPECT_EQ(results[t], results[0]);
+  EXPECT_EQ(f.size(), 7 + 499);
+  for (const auto &e : results[0]) {
+    EXPECT_LT(e->lhs->index, e->index);
+    EXPECT_LT(e->rhs->index, e->index);
+  }
+}
+
+TEST_F(HashConsTableTest, BTypeFactorySharing) {
+  // Deep DAGs: product keys do not depend on the size of the sub-types
+  auto t = BTypeFactory::Integer();
+  for (int i = 0; i < 200; ++i) t = BTypeFactory::Product(t, t);
+  auto u = BTypeFactory::Integer();
+  for (int i = 0; i < 200; ++i) u = BTypeFactory::Product(u, u);
+  EXPECT_EQ(t, u);
+  EXPECT_EQ(BTypeFactory::size(), 201);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
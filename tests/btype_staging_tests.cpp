@@ -0,0 +1,156 @@
+/* @file btype_staging_tests.cpp
+   @brief Unit tests for the BTypeStaging class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "btype.h"
+#include "btype_staging.h"
+#include "btype_subscription.h"
+
+class BTypeStagingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+};
+
+TEST_F(BTypeStagingTest, StagedTypesAreNotPublished) {
+  BTypeStaging staging;
+  auto intType = staging.Integer();
+  auto boolType = staging.Boolean();
+  const size_t sizeBefore = BTypeFactory::size();
+
+  auto product = staging.Product(intType, boolType);
+  auto power = staging.PowerSet(product);
+  auto set = staging.AbstractSet("StagedSet");
+  auto record = staging.Struct({{"s1", power}, {"s2", set}});
+
+  EXPECT_TRUE(BTypeStaging::isStaged(*product));
+  EXPECT_TRUE(BTypeStaging::isStaged(*power));
+  EXPECT_TRUE(BTypeStaging::isStaged(*set));
+  EXPECT_TRUE(BTypeStaging::isStaged(*record));
+  EXPECT_FALSE(BTypeStaging::isStaged(*intType));
+  EXPECT_EQ(staging.size(), 4);
+  EXPECT_EQ(BTypeFactory::size(), sizeBefore);
+
+  // Types are hash-consed within the builder
+  EXPECT_EQ(staging.Product(intType, boolType), product);
+  EXPECT_EQ(staging.Struct({{"s2", set}, {"s1", power}}), record);
+  EXPECT_NE(staging.Struct({{"s2", set}, {"s1", product}}), record);
+  EXPECT_EQ(product->toProductType()->lhs, intType);
+
+  staging.clear();
+  EXPECT_EQ(staging.size(), 0);
+  EXPECT_EQ(BTypeFactory::size(), sizeBefore);
+}
+
+TEST_F(BTypeStagingTest, PublishedTypesAreShared) {
+  auto published = BTypeFactory::PowerSet(
+      BTypeFactory::Product(BTypeFactory::String(), BTypeFactory::Real()));
+  BTypeStaging staging;
+  auto product = staging.Product(staging.String(), staging.Real());
+  EXPECT_FALSE(BTypeStaging::isStaged(*product));
+  EXPECT_EQ(staging.PowerSet(product), published);
+  EXPECT_EQ(staging.size(), 0);
+}
+
+TEST_F(BTypeStagingTest, CommitPublishesOnlySelectedCandidates) {
+  BTypeStaging staging;
+  auto base = staging.Product(staging.Float(), staging.Integer());
+  std::vector<std::shared_ptr<BType>> candidates;
+  for (int i = 0; i < 10; ++i) {
+    candidates.push_back(
+        staging.Struct({{"candidate", base},
+                        {"rank", staging.AbstractSet("Rank" +
+                                                     std::to_string(i))}}));
+  }
+  const size_t sizeBefore = BTypeFactory::size();
+  auto kept = staging.commit({candidates[2], candidates[7]});
+  ASSERT_EQ(kept.size(), 2);
+  // base, two abstract sets and two structs
+  EXPECT_EQ(BTypeFactory::size(), sizeBefore + 5);
+  for (const auto &type : kept) {
+    EXPECT_FALSE(BTypeStaging::isStaged(*type));
+    EXPECT_EQ(BTypeFactory::at(type->index()), type);
+  }
+  EXPECT_EQ(kept[0]->toStructType()->m_fields[0].second,
+            BTypeFactory::Product(BTypeFactory::Float(),
+                                  BTypeFactory::Integer()));
+  // Committing again returns the same published type
+  EXPECT_EQ(staging.commit(candidates[2]), kept[0]);
+  // Staged types built over committed ones reuse the table
+  EXPECT_EQ(staging.Struct({{"rank", staging.AbstractSet("Rank2")},
+                            {"candidate", base}}),
+            kept[0]);
+}
+
+TEST_F(BTypeStagingTest, StagedTypesAreRejectedByTheFactory) {
+  BTypeStaging staging;
+  auto staged = staging.AbstractSet("Unpublished");
+  const size_t sizeBefore = BTypeFactory::size();
+  EXPECT_THROW(BTypeFactory::PowerSet(staged), BTypeFactory::Exception);
+  EXPECT_THROW(BTypeFactory::Product(BTypeFactory::Integer(), staged),
+               BTypeFactory::Exception);
+  EXPECT_THROW(BTypeFactory::Struct({{"s", staged}}), BTypeFactory::Exception);
+  EXPECT_EQ(BTypeFactory::size(), sizeBefore);
+}
+
+TEST_F(BTypeStagingTest, CommitIsOneBatch) {
+  BTypeStaging staging;
+  std::shared_ptr<BType> type = staging.AbstractSet("Deep");
+  // Long enough to overflow the stack if the commit recursed
+  for (int depth = 0; depth < 100000; ++depth)
+    type = staging.PowerSet(staging.Product(type, staging.Integer()));
+  auto other = staging.Struct({{"deep", type}, {"flag", staging.Boolean()}});
+
+  std::vector<size_t> batches;
+  BTypeListener listener(
+      [&](const auto &batch) { batches.push_back(batch.size()); });
+  const size_t sizeBefore = BTypeFactory::size();
+  auto committed = staging.commit({other, type});
+  ASSERT_EQ(batches.size(), 1u);
+  EXPECT_EQ(batches[0], 200002u);
+  EXPECT_EQ(BTypeFactory::size(), sizeBefore + 200002);
+  EXPECT_EQ(committed[0]->toStructType()->m_fields[0].second, committed[1]);
+  EXPECT_EQ(committed[1]->index(), sizeBefore + 200000);
+}
+
+TEST_F(BTypeStagingTest, ThreadPrivateBuilders) {
+  const int numThreads = 8;
+  std::vector<std::thread> threads;
+  std::vector<std::shared_ptr<BType>> results(numThreads);
+  for (int i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&results, i]() {
+      BTypeStaging staging;
+      std::shared_ptr<BType> type = staging.Boolean();
+      for (int depth = 0; depth < 8; ++depth) {
+        type = staging.PowerSet(staging.Product(type, staging.String()));
+        staging.AbstractSet("Discarded" + std::to_string(i));
+      }
+      results[i] = staging.commit(type);
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  for (const auto &result : results) EXPECT_EQ(result, results[0]);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,238 @@
+/* @file btype_subscription_tests.cpp
+   @brief Unit tests for the BTypeSubscription and BTypeListener classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "btype.h"
+#include "btype_subscription.h"
+
+// When set, the next allocation fails
+static std::atomic<bool> failNextAllocation{false};
+
+// Blocks are offset by a header, as in btype_memory_bench: GCC rejects
+// operator delete calling std::free on a pointer returned by operator new
+static constexpr size_t header = alignof(std::max_align_t);
+
+void *operator new(size_t size) {
+  if (failNextAllocation.exchange(false)) throw std::bad_alloc();
+  if (void *p = std::malloc(header + size)) {
+    return static_cast<char *>(p) + header;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept {
+  if (p != nullptr) std::free(static_cast<char *>(p) - header);
+}
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+namespace {
+
+// Checks that types are the types of the table from index first on
+void expectTable(const std::vector<std::shared_ptr<BType>> &types,
+                 size_t first) {
+  for (size_t i = 0; i < types.size(); ++i) {
+    EXPECT_EQ(types[i]->index(), first + i);
+    EXPECT_EQ(types[i], BTypeFactory::at(first + i));
+  }
+}
+
+}  // namespace
+
+TEST(BTypeSubscriptionTest, Poll) {
+  BTypeSubscription subscription;
+  const size_t first = subscription.next();
+  std::vector<std::shared_ptr<BType>> batch;
+  EXPECT_EQ(subscription.poll(batch), 0u);
+
+  auto t = BTypeFactory::Integer();
+  for (int i = 0; i < 10; ++i) t = BTypeFactory::PowerSet(t);
+  BTypeFactory::PowerSet(BTypeFactory::Integer());  // already in the table
+  const size_t created = BTypeFactory::size() - first;
+  EXPECT_GE(created, 10u);
+
+  EXPECT_EQ(subscription.poll(batch, 4), 4u);
+  expectTable(batch, first);
+  EXPECT_EQ(subscription.poll(batch), created - 4);
+  expectTable(batch, first + 4);
+  EXPECT_EQ(batch.back(), t);
+  EXPECT_EQ(subscription.poll(batch), 0u);
+  EXPECT_TRUE(batch.empty());
+  EXPECT_EQ(subscription.next(), BTypeFactory::size());
+
+  BTypeSubscription replay(0);
+  EXPECT_EQ(replay.poll(batch), BTypeFactory::size());
+  expectTable(batch, 0);
+}
+
+TEST(BTypeSubscriptionTest, Listener) {
+  std::vector<std::shared_ptr<BType>> received;
+  size_t nbBatches = 0;
+  size_t first;
+  {
+    BTypeListener listener([&](const auto &batch) {
+      received.insert(received.end(), batch.begin(), batch.end());
+      ++nbBatches;
+    });
+    first = BTypeFactory::size();
+    BTypeFactory::Integer();
+    EXPECT_EQ(nbBatches, 0u);
+    auto t = BTypeFactory::Real();
+    for (int i = 0; i < 5; ++i) t = BTypeFactory::Product(t, t);
+    EXPECT_EQ(received.size(), BTypeFactory::size() - first);
+    EXPECT_EQ(received.back(), t);
+  }
+  expectTable(received, first);
+  const size_t count = received.size();
+  BTypeFactory::AbstractSet("NotListened");
+  EXPECT_EQ(received.size(), count);
+  EXPECT_GE(nbBatches, 5u);
+}
+
+TEST(BTypeSubscriptionTest, ListenerFromStart) {
+  std::vector<std::shared_ptr<BType>> received;
+  BTypeFactory::AbstractSet("Start");
+  BTypeListener listener(
+      [&](const auto &batch) {
+        received.insert(received.end(), batch.begin(), batch.end());
+      },
+      0);
+  // Lookups of existing types deliver nothing
+  BTypeFactory::Integer();
+  BTypeFactory::AbstractSet("Start");
+  EXPECT_TRUE(received.empty());
+  BTypeFactory::AbstractSet("Started");
+  EXPECT_EQ(received.size(), BTypeFactory::size());
+  expectTable(received, 0);
+}
+
+TEST(BTypeSubscriptionTest, ListenerCreatingTypes) {
+  std::vector<std::shared_ptr<BType>> received;
+  const size_t first = BTypeFactory::size();
+  BTypeListener listener([&](const auto &batch) {
+    received.insert(received.end(), batch.begin(), batch.end());
+    for (const auto &type : batch) {
+      if (type->getKind() == BType::Kind::AbstractSet)
+        BTypeFactory::PowerSet(type);
+    }
+  });
+  BTypeFactory::AbstractSet("Nested");
+  ASSERT_EQ(received.size(), 2u);
+  EXPECT_EQ(received[1]->getKind(), BType::Kind::PowerType);
+  expectTable(received, first);
+}
+
+TEST(BTypeSubscriptionTest, ThrowingListener) {
+  std::vector<std::shared_ptr<BType>> received;
+  std::vector<std::shared_ptr<BType>> others;
+  bool fail = true;
+  const size_t first = BTypeFactory::size();
+  BTypeListener failing([&](const auto &batch) {
+    if (fail) throw std::runtime_error("boom");
+    received.insert(received.end(), batch.begin(), batch.end());
+  });
+  BTypeListener listener([&](const auto &batch) {
+    others.insert(others.end(), batch.begin(), batch.end());
+  });
+  auto type = BTypeFactory::AbstractSet("Thrown");
+  EXPECT_EQ(type->index(), first);
+  EXPECT_TRUE(received.empty());
+  ASSERT_EQ(others.size(), 1u);
+
+  // The lost batch comes again with the next creation
+  fail = false;
+  BTypeFactory::AbstractSet("AfterThrown");
+  ASSERT_EQ(received.size(), 2u);
+  EXPECT_EQ(received[0], type);
+  expectTable(received, first);
+  EXPECT_EQ(others.size(), 2u);
+}
+
+TEST(BTypeSubscriptionTest, FailingDelivery) {
+  std::vector<std::shared_ptr<BType>> received;
+  std::vector<std::shared_ptr<BType>> all;
+  bool fail = true;
+  const size_t first = BTypeFactory::size();
+  BTypeListener listener([&](const auto &batch) {
+    received.insert(received.end(), batch.begin(), batch.end());
+    // Makes the copy of the table for the next listener fail
+    if (fail) failNextAllocation = true;
+  });
+  BTypeListener fromStart(
+      [&](const auto &batch) {
+        all.insert(all.end(), batch.begin(), batch.end());
+      },
+      0);
+  EXPECT_THROW(BTypeFactory::AbstractSet("FailedDelivery"), std::bad_alloc);
+  EXPECT_FALSE(failNextAllocation);
+  ASSERT_EQ(received.size(), 1u);
+  EXPECT_TRUE(all.empty());
+
+  // The next creation delivers again, including what was not delivered
+  fail = false;
+  BTypeFactory::AbstractSet("AfterFailedDelivery");
+  ASSERT_EQ(received.size(), 2u);
+  expectTable(received, first);
+  EXPECT_EQ(all.size(), BTypeFactory::size());
+  expectTable(all, 0);
+}
+
+TEST(BTypeSubscriptionTest, ConcurrentCreations) {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<BType>> received;
+  const size_t first = BTypeFactory::size();
+  BTypeListener listener([&](const auto &batch) {
+    std::lock_guard<std::mutex> lock(mutex);
+    received.insert(received.end(), batch.begin(), batch.end());
+  });
+  BTypeSubscription subscription;
+  std::vector<std::thread> threads;
+  for (int k = 0; k < 4; ++k) {
+    threads.emplace_back([k] {
+      for (int i = 0; i < 500; ++i) {
+        BTypeFactory::EnumeratedSet(
+            "E" + std::to_string(k) + "_" + std::to_string(i), {"a", "b"});
+      }
+    });
+  }
+  std::vector<std::shared_ptr<BType>> polled;
+  std::vector<std::shared_ptr<BType>> batch;
+  while (polled.size() < 2000) {
+    subscription.poll(batch);
+    polled.insert(polled.end(), batch.begin(), batch.end());
+  }
+  for (auto &thread : threads) thread.join();
+  EXPECT_EQ(polled.size(), 2000u);
+  expectTable(polled, first);
+  EXPECT_EQ(received.size(), 2000u);
+  expectTable(received, first);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
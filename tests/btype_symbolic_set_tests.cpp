@@ -0,0 +1,236 @@
+/* @file btype_symbolic_set_tests.cpp
+   @brief Unit tests for the BTypeBddLayout and BSymbolicSet classes.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "btype.h"
+#include "btype_symbolic_set.h"
+#include "btype_value.h"
+#include "btype_value_generator.h"
+
+class BSymbolicSetTest : public ::testing::Test {
+ protected:
+  // An enumerated set of n values
+  static std::shared_ptr<BType> enumeration(const std::string &name,
+                                            size_t n) {
+    std::vector<std::string> values;
+    for (size_t i = 0; i < n; ++i) values.push_back(name + std::to_string(i));
+    return BTypeFactory::EnumeratedSet(name, values);
+  }
+
+  std::shared_ptr<BddManager> manager = std::make_shared<BddManager>();
+};
+
+TEST_F(BSymbolicSetTest, Layout) {
+  auto colors = enumeration("LayoutColors", 5);
+  auto boolType = BTypeFactory::Boolean();
+  auto layout = BTypeBddLayout::of(colors);
+  EXPECT_EQ(layout, BTypeBddLayout::of(colors));
+  EXPECT_EQ(layout->width(), 3u);
+  EXPECT_EQ(layout->cardinality(), 5u);
+  EXPECT_EQ(BTypeBddLayout::of(boolType)->width(), 1u);
+
+  // The bits of the operands of a product are interleaved
+  auto pairs = BTypeBddLayout::of(BTypeFactory::Product(colors, colors));
+  EXPECT_EQ(pairs->width(), 6u);
+  EXPECT_EQ(pairs->cardinality(), 25u);
+  for (uint32_t bit = 0; bit < 3; ++bit) {
+    EXPECT_EQ(pairs->variable(bit), 2 * bit);
+    EXPECT_EQ(pairs->variable(3 + bit), 2 * bit + 1);
+  }
+  EXPECT_EQ(pairs->ordinals(13), (std::vector<uint64_t>{2, 3}));
+  EXPECT_EQ(pairs->rank({2, 3}), 13u);
+
+  auto record = BTypeBddLayout::of(
+      BTypeFactory::Struct({{"a", boolType}, {"b", colors}}));
+  EXPECT_EQ(record->width(), 4u);
+  EXPECT_EQ(record->cardinality(), 10u);
+  EXPECT_EQ(record->fields().size(), 2u);
+
+  EXPECT_THROW(BTypeBddLayout::of(BTypeFactory::Integer()),
+               BTypeFactory::Exception);
+  EXPECT_THROW(BTypeBddLayout::of(BTypeFactory::PowerSet(colors)),
+               BTypeFactory::Exception);
+  EXPECT_THROW(BTypeBddLayout::of(BTypeFactory::Product(
+                   colors, BTypeFactory::AbstractSet("LayoutAbstract"))),
+               BTypeFactory::Exception);
+  EXPECT_THROW(layout->ordinals(5), BTypeFactory::Exception);
+}
+
+TEST_F(BSymbolicSetTest, Algebra) {
+  auto colors = enumeration("AlgebraColors", 5);
+  auto none = BSymbolicSet::empty(manager, colors);
+  auto all = BSymbolicSet::universe(manager, colors);
+  EXPECT_TRUE(none.isEmpty());
+  EXPECT_EQ(none.count(), 0);
+  EXPECT_EQ(all.count(), 5);
+  EXPECT_EQ(all.ranks(), (std::vector<uint64_t>{0, 1, 2, 3, 4}));
+  EXPECT_FALSE(all.contains(5));
+  EXPECT_THROW(BSymbolicSet::singleton(manager, colors, 5),
+               BTypeFactory::Exception);
+
+  auto odd = BSymbolicSet::singleton(manager, colors, 1)
+                 .unite(BSymbolicSet::singleton(manager, colors, 3));
+  EXPECT_EQ(odd.ranks(), (std::vector<uint64_t>{1, 3}));
+  EXPECT_EQ(odd.complement().ranks(), (std::vector<uint64_t>{0, 2, 4}));
+  EXPECT_EQ(odd.complement().complement(), odd);
+  EXPECT_EQ(odd.unite(odd.complement()), all);
+  EXPECT_EQ(odd.intersect(odd.complement()), none);
+  EXPECT_EQ(all.subtract(odd), odd.complement());
+  EXPECT_TRUE(odd.contains(3));
+  EXPECT_FALSE(odd.contains(2));
+  EXPECT_EQ(all.ranks(2), (std::vector<uint64_t>{0, 1}));
+
+  // Sets of different types or managers do not mix
+  auto other = enumeration("AlgebraOther", 5);
+  EXPECT_THROW(odd.unite(BSymbolicSet::universe(manager, other)),
+               BTypeFactory::Exception);
+  EXPECT_THROW(
+      odd.unite(BSymbolicSet::universe(std::make_shared<BddManager>(), colors)),
+      BTypeFactory::Exception);
+}
+
+TEST_F(BSymbolicSetTest, Products) {
+  auto boolType = BTypeFactory::Boolean();
+  auto digits = enumeration("ProductDigits", 10);
+  auto type = BTypeFactory::Struct(
+      {{"d", digits}, {"p", BTypeFactory::Product(digits, boolType)}});
+  auto all = BSymbolicSet::universe(manager, type);
+  EXPECT_EQ(all.count(), 200);
+  auto some = BSymbolicSet::empty(manager, type);
+  for (uint64_t rank = 0; rank < 200; rank += 7)
+    some = some.unite(BSymbolicSet::singleton(manager, type, rank));
+  EXPECT_EQ(some.count(), 29);
+  for (uint64_t rank = 0; rank < 200; ++rank)
+    EXPECT_EQ(some.contains(rank), rank % 7 == 0);
+  EXPECT_EQ(some.complement().count(), 171);
+}
+
+TEST_F(BSymbolicSetTest, SmallestRanks) {
+  // The variables of a product are interleaved, but the ranks come in rank
+  // order
+  auto four = enumeration("RankFour", 4);
+  auto type = BTypeFactory::Product(four, four);
+  auto all = BSymbolicSet::universe(manager, type);
+  EXPECT_EQ(all.ranks(4), (std::vector<uint64_t>{0, 1, 2, 3}));
+  std::vector<uint64_t> expected(16);
+  for (uint64_t rank = 0; rank < 16; ++rank) expected[rank] = rank;
+  EXPECT_EQ(all.ranks(), expected);
+  auto some = all.subtract(BSymbolicSet::singleton(manager, type, 1))
+                  .subtract(BSymbolicSet::singleton(manager, type, 4));
+  EXPECT_EQ(some.ranks(3), (std::vector<uint64_t>{0, 2, 3}));
+}
+
+TEST_F(BSymbolicSetTest, Values) {
+  auto colors = enumeration("ValueColors", 3);
+  auto type = BTypeFactory::Product(
+      BTypeFactory::Struct({{"c", colors}, {"b", BTypeFactory::Boolean()}}),
+      colors);
+  BRandom random(3);
+  BValueBatch batch;
+  BValueGenerator::of(type)->fill(random, 100, batch);
+  auto set = BSymbolicSet::empty(manager, type);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    auto singleton = BSymbolicSet::singleton(manager, batch[i]);
+    EXPECT_EQ(singleton.count(), 1);
+    EXPECT_TRUE(singleton.contains(batch[i]));
+    set = set.unite(singleton);
+  }
+  for (size_t i = 0; i < batch.size(); ++i) {
+    EXPECT_TRUE(set.contains(batch[i]));
+    EXPECT_FALSE(set.complement().contains(batch[i]));
+  }
+
+  BValueBatch others;
+  BValueGenerator::of(colors)->fill(random, 1, others);
+  EXPECT_THROW(set.contains(others[0]), BTypeFactory::Exception);
+}
+
+TEST_F(BSymbolicSetTest, Relations) {
+  const uint64_t n = 100;
+  auto states = enumeration("RelationStates", n);
+  auto type = BTypeFactory::Product(states, states);
+  auto next = BSymbolicSet::empty(manager, type);
+  for (uint64_t i = 0; i + 1 < n; ++i)
+    next = next.unite(BSymbolicSet::singleton(manager, type, i * n + i + 1));
+  EXPECT_EQ(next.count(), n - 1);
+
+  auto initial = BSymbolicSet::singleton(manager, states, 0);
+  EXPECT_EQ(next.image(initial).ranks(), (std::vector<uint64_t>{1}));
+  EXPECT_EQ(next.preimage(BSymbolicSet::singleton(manager, states, 7)).ranks(),
+            (std::vector<uint64_t>{6}));
+  EXPECT_TRUE(next.preimage(initial).isEmpty());
+
+  // Reachable states, by a fixed point of the image
+  auto reached = initial;
+  for (;;) {
+    auto more = reached.unite(next.image(reached));
+    if (more == reached) break;
+    reached = more;
+  }
+  EXPECT_EQ(reached, BSymbolicSet::universe(manager, states));
+
+  // A relation between different types
+  auto flags = BTypeFactory::Boolean();
+  auto parity = BTypeFactory::Product(states, flags);
+  auto isOdd = BSymbolicSet::empty(manager, parity);
+  for (uint64_t i = 0; i < n; ++i) {
+    isOdd =
+        isOdd.unite(BSymbolicSet::singleton(manager, parity, 2 * i + i % 2));
+  }
+  auto trueSet = BSymbolicSet::singleton(manager, flags, 1);
+  EXPECT_EQ(isOdd.preimage(trueSet).count(), n / 2);
+  EXPECT_EQ(isOdd.image(BSymbolicSet::universe(manager, states)),
+            BSymbolicSet::universe(manager, flags));
+  EXPECT_THROW(isOdd.image(trueSet), BTypeFactory::Exception);
+  EXPECT_THROW(initial.image(initial), BTypeFactory::Exception);
+}
+
+TEST_F(BSymbolicSetTest, LargeSets) {
+  // 2^40 values, but a few nodes
+  auto bytes = enumeration("LargeBytes", 256);
+  std::vector<std::pair<std::string, std::shared_ptr<BType>>> fields;
+  for (int i = 0; i < 5; ++i)
+    fields.emplace_back("f" + std::to_string(i), bytes);
+  auto type = BTypeFactory::Struct(fields);
+  auto all = BSymbolicSet::universe(manager, type);
+  EXPECT_EQ(all.count(), 1099511627776.0);
+  EXPECT_EQ(all.nbNodes(), 1u);
+  auto one = BSymbolicSet::singleton(manager, type, 123456789);
+  EXPECT_EQ(all.subtract(one).count(), 1099511627775.0);
+  EXPECT_EQ(one.ranks(), (std::vector<uint64_t>{123456789}));
+  EXPECT_EQ(one.nbNodes(), 42u);
+
+  // Many distinct nodes, to grow the tables
+  auto set = BSymbolicSet::empty(manager, type);
+  for (uint64_t rank = 0; rank < 5000; ++rank)
+    set = set.unite(BSymbolicSet::singleton(manager, type, rank * 7919));
+  EXPECT_EQ(set.count(), 5000);
+  EXPECT_TRUE(set.contains(4999 * 7919));
+  EXPECT_FALSE(set.contains(4999 * 7919 + 1));
+  EXPECT_GT(manager->size(), 4096u);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
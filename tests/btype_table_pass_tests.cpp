@@ -0,0 +1,120 @@
+/* @file btype_table_pass_tests.cpp
+   @brief Unit tests for the BTypeTablePass class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "btype.h"
+#include "btype_table_pass.h"
+
+class BTypeTablePassTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+};
+
+// Builds a table with a few thousand types of various depths.
+static void populate() {
+  auto intType = BTypeFactory::Integer();
+  auto boolType = BTypeFactory::Boolean();
+  std::vector<std::shared_ptr<BType>> layer{intType, boolType};
+  for (int depth = 0; depth < 6; ++depth) {
+    std::vector<std::shared_ptr<BType>> next;
+    for (size_t i = 0; i < layer.size() && next.size() < 1000; ++i) {
+      for (size_t j = 0; j < layer.size() && next.size() < 1000; ++j) {
+        next.push_back(BTypeFactory::Product(layer[i], layer[j]));
+      }
+      next.push_back(BTypeFactory::PowerSet(layer[i]));
+    }
+    layer = next;
+  }
+  BTypeFactory::Struct({{"a", layer.front()}, {"b", layer.back()}});
+}
+
+// Tree size, computed sequentially for reference.
+static size_t treeSize(const BType &type) {
+  size_t result = 1;
+  type.forEachChild([&](const std::shared_ptr<BType> &child) {
+    result += treeSize(*child);
+  });
+  return result;
+}
+
+TEST_F(BTypeTablePassTest, LevelsRespectDependencies) {
+  populate();
+  BTypeTablePass pass(4);
+  ASSERT_EQ(pass.size(), BTypeFactory::size());
+  size_t count = 0;
+  for (size_t l = 0; l < pass.levels().size(); ++l) {
+    for (size_t index : pass.levels()[l]) {
+      EXPECT_EQ(pass.level(index), l);
+      pass.at(index)->forEachChild([&](const std::shared_ptr<BType> &child) {
+        EXPECT_LT(pass.level(child->index()), l);
+      });
+      ++count;
+    }
+  }
+  EXPECT_EQ(count, pass.size());
+  EXPECT_EQ(pass.level(BTypeFactory::Integer()->index()), 0);
+}
+
+TEST_F(BTypeTablePassTest, ResultsMatchSequentialComputation) {
+  populate();
+  for (unsigned nbThreads : {1u, 2u, 8u}) {
+    BTypeTablePass pass(nbThreads);
+    std::vector<size_t> sizes = pass.run<size_t>(
+        [](const BType &type, const std::vector<size_t> &sizes) {
+          size_t result = 1;
+          type.forEachChild([&](const std::shared_ptr<BType> &child) {
+            result += sizes[child->index()];
+          });
+          return result;
+        });
+    ASSERT_EQ(sizes.size(), pass.size());
+    for (size_t i = 0; i < pass.size(); i += 97) {
+      EXPECT_EQ(sizes[i], treeSize(*BTypeFactory::at(i)));
+    }
+  }
+}
+
+TEST_F(BTypeTablePassTest, ForEachVisitsEveryTypeOnce) {
+  populate();
+  BTypeTablePass pass(3);
+  std::vector<std::atomic<int>> visits(pass.size());
+  pass.forEach([&](const BType &type) { visits[type.index()]++; });
+  for (size_t i = 0; i < pass.size(); ++i) EXPECT_EQ(visits[i].load(), 1);
+}
+
+TEST_F(BTypeTablePassTest, ExceptionsArePropagated) {
+  populate();
+  BTypeTablePass pass(4);
+  EXPECT_THROW(pass.run<int>([](const BType &type, const std::vector<int> &) {
+    if (type.getKind() == BType::Kind::Struct)
+      throw std::runtime_error("struct");
+    return 0;
+  }),
+               std::runtime_error);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
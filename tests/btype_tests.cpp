@@ -19,6 +19,7 @@
 #include <gtest/gtest.h>
 
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "btype.h"
@@ -79,12 +80,31 @@ TEST_F(BTypeTest, ProductTypeCreation) {
       BTypeFactory::Product(BTypeFactory::Integer(), BTypeFactory::Boolean());
   EXPECT_EQ(product->getKind(), BType::Kind::ProductType);
 
-  auto productType = product->toProductType();
+  std::shared_ptr<const BType::ProductType> productType =
+      product->toProductType();
   ASSERT_NE(productType, nullptr);
+  EXPECT_EQ(productType, product);
+  // The conversion shares the ownership of the table entry
+  EXPECT_FALSE(productType.owner_before(product) ||
+               product.owner_before(productType));
+  EXPECT_EQ(product->asProductType(), productType.get());
+  EXPECT_EQ(product->toPowerType(), nullptr);
+  EXPECT_EQ(product->asPowerType(), nullptr);
   EXPECT_EQ(productType->lhs->getKind(), BType::Kind::INTEGER);
   EXPECT_EQ(productType->rhs->getKind(), BType::Kind::BOOLEAN);
 }
 
+// Types are created and destroyed by the factory only. BType has no virtual
+// destructor, so deleting a type through a BType pointer must not compile.
+static_assert(!std::is_destructible_v<BType>);
+static_assert(!std::is_constructible_v<BType, BType::Kind>);
+static_assert(!std::is_constructible_v<BType::ProductType,
+                                       std::shared_ptr<BType>,
+                                       std::shared_ptr<BType>>);
+static_assert(
+    !std::is_constructible_v<BType::PowerType, std::shared_ptr<BType>>);
+static_assert(!std::is_constructible_v<BType::AbstractSet, std::string>);
+
 // Power Type Tests
 TEST_F(BTypeTest, PowerTypeCreation) {
   auto powerSet = BTypeFactory::PowerSet(BTypeFactory::Integer());
@@ -147,6 +167,16 @@ TEST_F(BTypeTest, StructTypeCreationOrder) {
   EXPECT_EQ(structType1, structType2);
 }
 
+TEST_F(BTypeTest, StructTypeFieldTypes) {
+  auto struct1 = BTypeFactory::Struct({{"label", BTypeFactory::Integer()}});
+  auto struct2 = BTypeFactory::Struct({{"label", BTypeFactory::Boolean()}});
+  EXPECT_NE(struct1, struct2);
+  EXPECT_EQ(struct2->toStructType()->m_fields[0].second->getKind(),
+            BType::Kind::BOOLEAN);
+  EXPECT_EQ(BTypeFactory::Struct({{"label", BTypeFactory::Integer()}}),
+            struct1);
+}
+
 // Comparison Tests
 TEST_F(BTypeTest, TypeComparisons) {
   auto int1 = BTypeFactory::Integer();
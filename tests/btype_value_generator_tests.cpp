@@ -0,0 +1,241 @@
+/* @file btype_value_generator_tests.cpp
+   @brief Unit tests for the BValueGenerator class.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "btype.h"
+#include "btype_value.h"
+#include "btype_value_generator.h"
+
+class BValueGeneratorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+};
+
+TEST_F(BValueGeneratorTest, Random) {
+  BRandom r1(7), r2(7), r3(8);
+  for (int i = 0; i < 100; ++i) {
+    const uint64_t v = r1.next();
+    EXPECT_EQ(v, r2.next());
+    EXPECT_NE(v, r3.next());
+  }
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_LT(r1.below(3), 3);
+    const double u = r1.unit();
+    EXPECT_GE(u, 0.0);
+    EXPECT_LT(u, 1.0);
+  }
+}
+
+TEST_F(BValueGeneratorTest, Scalars) {
+  BValueGenerator::Options options;
+  options.minInteger = -5;
+  options.maxInteger = 5;
+  options.maxStringLength = 4;
+  BRandom random(1);
+  BValueBatch batch;
+
+  BValueGenerator(BTypeFactory::Integer(), options).fill(random, 1000, batch);
+  ASSERT_EQ(batch.size(), 1000);
+  std::map<int64_t, int> counts;
+  for (size_t i = 0; i < batch.size(); ++i) ++counts[batch[i].asInteger()];
+  EXPECT_EQ(counts.size(), 11);
+  EXPECT_EQ(counts.begin()->first, -5);
+  EXPECT_EQ(counts.rbegin()->first, 5);
+  EXPECT_THROW(batch[0].asBoolean(), BTypeFactory::Exception);
+
+  BValueGenerator(BTypeFactory::String(), options).fill(random, 1000, batch);
+  for (size_t i = 0; i < batch.size(); ++i)
+    EXPECT_LE(batch[i].asString().size(), 4);
+
+  BValueGenerator(BTypeFactory::Real(), options).fill(random, 1000, batch);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    EXPECT_GE(batch[i].asReal(), -1000.0);
+    EXPECT_LT(batch[i].asReal(), 1000.0);
+  }
+
+  options.minInteger = INT64_MIN;
+  options.maxInteger = INT64_MAX;
+  BValueGenerator(BTypeFactory::Integer(), options).fill(random, 10, batch);
+  EXPECT_EQ(batch.size(), 10);
+}
+
+TEST_F(BValueGeneratorTest, UniformFiniteTypes) {
+  auto colors = BTypeFactory::EnumeratedSet("Colors", {"Red", "Green", "Blue"});
+  auto pair = BTypeFactory::Product(BTypeFactory::Boolean(), colors);
+  auto relation = BTypeFactory::PowerSet(pair);
+  auto generator = BValueGenerator::of(relation);
+  EXPECT_EQ(generator, BValueGenerator::of(relation));
+  EXPECT_EQ(BValueGenerator::of(pair)->cardinality(), 6);
+  EXPECT_EQ(generator->cardinality(), 64);
+
+  BRandom random(3);
+  BValueBatch batch;
+  const int samples = 64 * 200;
+  generator->fill(random, samples, batch);
+  ASSERT_EQ(batch.size(), samples);
+  std::map<std::string, int> counts;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const BValue value = batch[i];
+    for (size_t j = 1; j < value.size(); ++j)
+      EXPECT_LT(BValue::compare(value.element(j - 1), value.element(j)), 0);
+    ++counts[value.toString()];
+  }
+  // Each of the 64 relations is drawn about 200 times
+  EXPECT_EQ(counts.size(), 64);
+  for (const auto &[text, count] : counts) {
+    EXPECT_GT(count, 120) << text;
+    EXPECT_LT(count, 280) << text;
+  }
+  EXPECT_EQ(counts.count("{}"), 1);
+  EXPECT_EQ(counts.count("{(FALSE|->Red),(TRUE|->Blue)}"), 1);
+}
+
+TEST_F(BValueGeneratorTest, BoundedSets) {
+  BValueGenerator::Options options;
+  options.maxSetSize = 5;
+  options.uniform = false;
+  auto type = BTypeFactory::PowerSet(BTypeFactory::PowerSet(
+      BTypeFactory::Product(BTypeFactory::Integer(), BTypeFactory::Boolean())));
+  BValueGenerator generator(type, options);
+  EXPECT_EQ(generator.cardinality(), 0);
+
+  BRandom random(5);
+  BValueBatch batch;
+  generator.fill(random, 2000, batch);
+  size_t largest = 0;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const BValue value = batch[i];
+    EXPECT_LE(value.size(), 5);
+    largest = std::max(largest, value.size());
+    for (size_t j = 1; j < value.size(); ++j)
+      EXPECT_LT(BValue::compare(value.element(j - 1), value.element(j)), 0);
+  }
+  EXPECT_EQ(largest, 5);
+}
+
+TEST_F(BValueGeneratorTest, Structs) {
+  auto type = BTypeFactory::Struct(
+      {{"name", BTypeFactory::String()},
+       {"id", BTypeFactory::AbstractSet("ID")},
+       {"ok", BTypeFactory::Boolean()}});
+  BValueGenerator::Options options;
+  options.abstractSetSize = 2;
+  BValueGenerator generator(type, options);
+
+  BRandom random(11);
+  BValueBatch batch;
+  generator.fill(random, 100, batch);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const BValue value = batch[i];
+    ASSERT_EQ(value.size(), 3);
+    EXPECT_LT(value.element(0).ordinal(), 2);
+    value.element(2).asBoolean();
+    const std::string text = value.toString();
+    EXPECT_EQ(text.rfind("rec(id:ID", 0), 0) << text;
+  }
+
+  // Same seed, same values
+  BValueBatch other;
+  BRandom again(11);
+  generator.fill(again, 100, other);
+  for (size_t i = 0; i < batch.size(); ++i)
+    EXPECT_EQ(BValue::compare(batch[i], other[i]), 0);
+}
+
+TEST_F(BValueGeneratorTest, InvalidTypes) {
+  EXPECT_THROW(BValueGenerator(BTypeFactory::EnumeratedSet("Empty", {})),
+               BTypeFactory::Exception);
+  BValueGenerator::Options options;
+  options.abstractSetSize = 0;
+  EXPECT_THROW(BValueGenerator(BTypeFactory::AbstractSet("S"), options),
+               BTypeFactory::Exception);
+  options = BValueGenerator::Options();
+  options.minInteger = 1;
+  options.maxInteger = 0;
+  EXPECT_THROW(BValueGenerator(BTypeFactory::Integer(), options),
+               BTypeFactory::Exception);
+}
+
+TEST_F(BValueGeneratorTest, DeepTypes) {
+  // Deeper than the thread stack would allow for a recursive generator
+  const size_t depth = 100000;
+  auto tuple = BTypeFactory::Boolean();
+  auto power = BTypeFactory::Boolean();
+  for (size_t i = 0; i < depth; ++i) {
+    tuple = BTypeFactory::Product(tuple, BTypeFactory::Boolean());
+    power = BTypeFactory::PowerSet(power);
+  }
+
+  // The innermost tuples are drawn uniformly, the others member by member;
+  // sorting the sets compares the tuples down to their innermost member
+  BValueGenerator generator(BTypeFactory::PowerSet(tuple));
+  EXPECT_EQ(generator.cardinality(), 0);
+  BRandom random(13);
+  BValueBatch batch;
+  generator.fill(random, 4, batch);
+  size_t elements = 0;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const BValue value = batch[i];
+    elements += value.size();
+    for (size_t j = 1; j < value.size(); ++j)
+      EXPECT_LT(BValue::compare(value.element(j - 1), value.element(j)), 0);
+    for (size_t j = 0; j < value.size(); ++j) {
+      BValue member = value.element(j);
+      for (size_t level = 0; level < depth; ++level) member = member.first();
+      member.asBoolean();
+    }
+  }
+  EXPECT_GT(elements, 0);
+
+  BValueGenerator::Options options;
+  options.maxSetSize = 1;
+  BValueGenerator powers(power, options);
+  EXPECT_EQ(powers.cardinality(), 0);
+  powers.fill(random, 100, batch);
+  EXPECT_EQ(batch.size(), 100);
+}
+
+TEST_F(BValueGeneratorTest, ConcurrentBatches) {
+  auto type = BTypeFactory::PowerSet(
+      BTypeFactory::Product(BTypeFactory::Integer(), BTypeFactory::String()));
+  std::vector<std::thread> threads;
+  std::vector<size_t> sizes(4);
+  for (size_t t = 0; t < sizes.size(); ++t) {
+    threads.emplace_back([&, t] {
+      BRandom random(t);
+      BValueBatch batch;
+      for (int round = 0; round < 10; ++round) {
+        BValueGenerator::of(type)->fill(random, 1000, batch);
+        sizes[t] += batch.size();
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  for (size_t size : sizes) EXPECT_EQ(size, 10000);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
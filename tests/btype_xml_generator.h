@@ -0,0 +1,85 @@
+/* @file btype_xml_generator.h
+   @brief Generator of large RichTypesInfo documents, shared by the tests and
+   the benchmarks.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef BTYPE_XML_GENERATOR_H
+#define BTYPE_XML_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+/**
+ * @brief Generates a RichTypesInfo document where each entry refers to
+ * earlier ones.
+ *
+ * The entries are drawn by a linear congruential generator, so that a seed
+ * always gives the same document. The first two entries are INTEGER and
+ * BOOL; the others are abstract sets, enumerated sets, power sets, structs
+ * with one field and products. There are 16 enumerated set names, so that
+ * each name occurs many times; the values of a set depend only on its name.
+ *
+ * @param nbTypes the number of entries, at least 2
+ * @param seed the seed of the generator
+ * @return the text of the document
+ */
+inline std::string generateRichTypesInfo(size_t nbTypes, uint64_t seed = 42) {
+  std::ostringstream os;
+  os << "<RichTypesInfo>\n";
+  os << "  <RichType id=\"0\">\n    <INTEGER/>\n  </RichType>\n";
+  os << "  <RichType id=\"1\">\n    <BOOL/>\n  </RichType>\n";
+  auto next = [&seed](size_t bound) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<size_t>((seed >> 33) % bound);
+  };
+  for (size_t id = 2; id < nbTypes; ++id) {
+    os << "  <RichType id=\"" << id << "\">\n    ";
+    switch (next(8)) {
+      case 0:
+        os << "<AbstractSet name=\"GenSet" << id << "\"/>";
+        break;
+      case 1: {
+        const size_t name = next(16);
+        os << "<EnumeratedSet name=\"GenEnum" << name << "\">";
+        for (size_t value = 0; value <= name % 4; ++value) {
+          os << "\n      <EnumeratedValue name=\"GenEnum" << name << "_"
+             << value << "\"/>";
+        }
+        os << "\n    </EnumeratedSet>";
+        break;
+      }
+      case 2:
+        os << "<PowerSet arg=\"" << next(id) << "\"/>";
+        break;
+      case 3:
+        os << "<StructType>\n      <Field name=\"gen" << id << "\" type=\""
+           << next(id) << "\"/>\n    </StructType>";
+        break;
+      default:
+        os << "<CartesianProduct arg1=\"" << next(id) << "\" arg2=\""
+           << next(id) << "\"/>";
+        break;
+    }
+    os << "\n  </RichType>\n";
+  }
+  os << "</RichTypesInfo>\n";
+  return os.str();
+}
+
+#endif  // BTYPE_XML_GENERATOR_H
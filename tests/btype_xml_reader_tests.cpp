@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "btype.h"
+#include "btype_xml_generator.h"
 #include "tinyxml2.h"
 
 class BTypeTest : public ::testing::Test {
@@ -111,6 +112,91 @@ TEST_F(BTypeTest, XMLBuildTest) {
       BType::Kind::BOOLEAN);
 }
 
+TEST_F(BTypeTest, XMLParallelBuildTest) {
+  std::string xmlContent = generateRichTypesInfo(5000);
+  tinyxml2::XMLDocument doc;
+  ASSERT_EQ(doc.Parse(xmlContent.c_str()), tinyxml2::XML_SUCCESS);
+  tinyxml2::XMLElement* root = doc.FirstChildElement("RichTypesInfo");
+  ASSERT_NE(root, nullptr);
+
+  std::vector<std::shared_ptr<BType>> parallel =
+      BTypeFactory::buildFromXML(root, 4);
+  std::vector<std::shared_ptr<BType>> sequential =
+      BTypeFactory::buildFromXML(root);
+  ASSERT_EQ(parallel.size(), 5000);
+  EXPECT_EQ(parallel, sequential);
+
+  for (auto elem = root->FirstChildElement("RichType"); elem;
+       elem = elem->NextSiblingElement("RichType")) {
+    int id = elem->IntAttribute("id");
+    const tinyxml2::XMLElement* def = elem->FirstChildElement();
+    const auto& type = parallel[id];
+    std::string name = def->Name();
+    if (name == "PowerSet") {
+      EXPECT_EQ(type->toPowerType()->m_content,
+                parallel[def->IntAttribute("arg")]);
+    } else if (name == "CartesianProduct") {
+      EXPECT_EQ(type->toProductType()->lhs,
+                parallel[def->IntAttribute("arg1")]);
+      EXPECT_EQ(type->toProductType()->rhs,
+                parallel[def->IntAttribute("arg2")]);
+    } else if (name == "StructType") {
+      const tinyxml2::XMLElement* field = def->FirstChildElement("Field");
+      EXPECT_EQ(type->toStructType()->m_fields[0].second,
+                parallel[field->IntAttribute("type")]);
+    } else if (name == "EnumeratedSet") {
+      EXPECT_EQ(type->toEnumeratedSetType()->getName(),
+                def->Attribute("name"));
+    }
+  }
+}
+
+TEST_F(BTypeTest, XMLCyclicReferenceTest) {
+  const char* xmlContent = R"(
+    <RichTypesInfo>
+      <RichType id="0">
+        <PowerSet arg="1"/>
+      </RichType>
+      <RichType id="1">
+        <CartesianProduct arg1="0" arg2="0"/>
+      </RichType>
+    </RichTypesInfo>
+  )";
+  tinyxml2::XMLDocument doc;
+  ASSERT_EQ(doc.Parse(xmlContent), tinyxml2::XML_SUCCESS);
+  tinyxml2::XMLElement* root = doc.FirstChildElement("RichTypesInfo");
+  EXPECT_THROW(BTypeFactory::buildFromXML(root), BTypeFactory::Exception);
+  EXPECT_THROW(BTypeFactory::buildFromXML(root, 2), BTypeFactory::Exception);
+}
+
+TEST_F(BTypeTest, XMLDuplicateEnumeratedSetTest) {
+  // The first set in the order of the sequential build wins, whatever the
+  // number of threads: here id 2, reached from id 0 before id 1
+  for (unsigned nbThreads : {1u, 4u}) {
+    const std::string name = "XMLDuplicate" + std::to_string(nbThreads);
+    const std::string xmlContent =
+        "<RichTypesInfo>"
+        "<RichType id=\"0\"><PowerSet arg=\"2\"/></RichType>"
+        "<RichType id=\"1\"><EnumeratedSet name=\"" + name + "\">"
+        "<EnumeratedValue name=\"A\"/></EnumeratedSet></RichType>"
+        "<RichType id=\"2\"><EnumeratedSet name=\"" + name + "\">"
+        "<EnumeratedValue name=\"B\"/></EnumeratedSet></RichType>"
+        "<RichType id=\"3\"><CartesianProduct arg1=\"1\" arg2=\"2\"/>"
+        "</RichType>"
+        "</RichTypesInfo>";
+    tinyxml2::XMLDocument doc;
+    ASSERT_EQ(doc.Parse(xmlContent.c_str()), tinyxml2::XML_SUCCESS);
+    tinyxml2::XMLElement* root = doc.FirstChildElement("RichTypesInfo");
+    auto types = BTypeFactory::buildFromXML(root, nbThreads);
+    ASSERT_EQ(types.size(), 4u);
+    EXPECT_EQ(types[1], types[2]);
+    EXPECT_EQ(types[2]->toEnumeratedSetType()->getValues(),
+              std::vector<std::string>{"B"});
+    EXPECT_EQ(types[0], BTypeFactory::PowerSet(types[2]));
+    EXPECT_EQ(types[3], BTypeFactory::Product(types[2], types[2]));
+  }
+}
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
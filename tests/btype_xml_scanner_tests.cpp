@@ -0,0 +1,182 @@
+/* @file btype_xml_scanner_tests.cpp
+   @brief Unit tests for the BTypeFactory::readXMLRichTypesInfo method.
+
+   @note This file is part of BTYPE.
+   @copyright Copyright © CLEARSY 2025
+   @license GNU General Public License (GPL) version 3
+
+   BTYPE is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "btype.h"
+#include "tinyxml2.h"
+
+class BTypeXMLScannerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+};
+
+TEST_F(BTypeXMLScannerTest, ReadTest) {
+  const char* xmlContent = R"(<?xml version="1.0" encoding="UTF-8"?>
+    <!-- generated -->
+    <RichTypesInfo>
+      <RichType id="0">
+        <INTEGER/>
+      </RichType>
+      <RichType id='1'><BOOL></BOOL></RichType>
+      <RichType id="2">
+        <PowerSet arg="0"/>
+      </RichType>
+      <RichType id="3">
+        <CartesianProduct arg2="1" arg1=" 0 "/>
+      </RichType>
+      <RichType id="4">
+        <AbstractSet name="My&lt;Abstract&#x3E;Set"/>
+      </RichType>
+      <RichType id="5">
+        <EnumeratedSet name="MyEnumSet">
+          <EnumeratedValue name="Value1"/>
+          <!-- a comment -->
+          <EnumeratedValue name="Value2"></EnumeratedValue>
+        </EnumeratedSet>
+      </RichType>
+      <RichType id="6">
+        <StructType>
+          <Field name="field2" type="1"/>
+          <Field name="field1" type="7"/>
+        </StructType>
+      </RichType>
+      <RichType id="7">
+        <STRING/>
+      </RichType>
+    </RichTypesInfo>
+  )";
+
+  std::vector<std::shared_ptr<BType>> types;
+  try {
+    types = BTypeFactory::readXMLRichTypesInfo(xmlContent);
+  } catch (const BTypeFactory::Exception& e) {
+    FAIL() << "Exception during XML read: " << e.what();
+  }
+
+  ASSERT_EQ(types.size(), 8);
+  EXPECT_EQ(types[0], BTypeFactory::Integer());
+  EXPECT_EQ(types[1], BTypeFactory::Boolean());
+  EXPECT_EQ(types[2], BTypeFactory::PowerSet(types[0]));
+  EXPECT_EQ(types[3], BTypeFactory::Product(types[0], types[1]));
+  EXPECT_EQ(types[4]->toAbstractSetType()->getName(), "My<Abstract>Set");
+  EXPECT_EQ(types[5]->toEnumeratedSetType()->getName(), "MyEnumSet");
+  EXPECT_EQ(types[5]->toEnumeratedSetType()->getValues(),
+            std::vector<std::string>({"Value1", "Value2"}));
+  EXPECT_EQ(types[6], BTypeFactory::Struct({{"field1", BTypeFactory::String()},
+                                            {"field2", types[1]}}));
+  EXPECT_EQ(types[7], BTypeFactory::String());
+}
+
+TEST_F(BTypeXMLScannerTest, RoundTripTest) {
+  auto pair =
+      BTypeFactory::Product(BTypeFactory::Real(), BTypeFactory::Float());
+  auto set = BTypeFactory::EnumeratedSet("Colors", {"Red", "Green", "Blue"});
+  for (int i = 0; i < 200; ++i) {
+    pair = BTypeFactory::Product(BTypeFactory::PowerSet(pair), set);
+    BTypeFactory::Struct({{"f" + std::to_string(i), pair}, {"set", set}});
+  }
+  std::ostringstream os;
+  BTypeFactory::writeXMLRichTypesInfo(os);
+  const size_t size = BTypeFactory::size();
+
+  for (unsigned nbThreads : {1u, 4u}) {
+    auto types = BTypeFactory::readXMLRichTypesInfo(os.str(), nbThreads);
+    ASSERT_EQ(types.size(), size);
+    for (size_t i = 0; i < size; ++i) EXPECT_EQ(types[i], BTypeFactory::at(i));
+  }
+}
+
+TEST_F(BTypeXMLScannerTest, WhiteSpaceInValuesTest) {
+  // tinyxml2 only turns line ends into '\n' in attribute values, where XML
+  // also turns tabs and line feeds into spaces
+  auto normalized = [](std::string value) {
+    for (char& c : value)
+      if (c == '\t' || c == '\n') c = ' ';
+    return value;
+  };
+  const std::vector<std::string> names = {
+      "Tab\tName",   "Tab\t&amp;\tName", "&lt;\tName",
+      "Line\nName",  "Line\r\nName",     "Line\rName",
+      "Mixed \t\r\n&#x41;\tName",
+  };
+  for (const auto& name : names) {
+    const std::string xml =
+        "<RichTypesInfo><RichType id=\"0\"><AbstractSet name=\"" + name +
+        "\"/></RichType></RichTypesInfo>";
+    tinyxml2::XMLDocument doc;
+    ASSERT_EQ(doc.Parse(xml.c_str()), tinyxml2::XML_SUCCESS) << name;
+    const char* expected = doc.FirstChildElement("RichTypesInfo")
+                               ->FirstChildElement("RichType")
+                               ->FirstChildElement("AbstractSet")
+                               ->Attribute("name");
+    ASSERT_NE(expected, nullptr);
+    auto types = BTypeFactory::readXMLRichTypesInfo(xml);
+    ASSERT_EQ(types.size(), 1u);
+    EXPECT_EQ(types[0]->toAbstractSetType()->getName(), normalized(expected))
+        << name;
+  }
+  auto types = BTypeFactory::readXMLRichTypesInfo(
+      "<RichTypesInfo><RichType id=\"0\"><AbstractSet name=\"a\t&amp;\tb\"/>"
+      "</RichType></RichTypesInfo>");
+  EXPECT_EQ(types[0]->toAbstractSetType()->getName(), "a & b");
+}
+
+TEST_F(BTypeXMLScannerTest, ErrorsTest) {
+  const std::vector<std::string> invalid = {
+      "",
+      "<RichTypesInfo>",
+      "<RichTypesInfo></RichTypes>",
+      "<RichTypesInfo><RichType id=\"1\"><BOOL/></RichType></RichTypesInfo>",
+      "<RichTypesInfo><RichType><BOOL/></RichType></RichTypesInfo>",
+      "<RichTypesInfo><RichType id=\"0\"></RichType></RichTypesInfo>",
+      "<RichTypesInfo><RichType id=\"0\"><Bool/></RichType></RichTypesInfo>",
+      "<RichTypesInfo><RichType id=\"0\"><BOOL/><BOOL/></RichType>"
+      "</RichTypesInfo>",
+      "<RichTypesInfo><RichType id=\"0\"><PowerSet arg=\"1\"/></RichType>"
+      "</RichTypesInfo>",
+      "<RichTypesInfo><RichType id=\"0\"><PowerSet arg=\"0\"/></RichType>"
+      "</RichTypesInfo>",
+      "<RichTypesInfo><RichType id=\"0\"><PowerSet arg=\"x\"/></RichType>"
+      "</RichTypesInfo>",
+      "<RichTypesInfo><RichType id=\"0\"><AbstractSet/></RichType>"
+      "</RichTypesInfo>",
+      "<RichTypesInfo><RichType id=\"0\"><AbstractSet name=\"a&b\"/>"
+      "</RichType></RichTypesInfo>",
+      "<RichTypesInfo><RichType id=\"0\" id=\"0\"><BOOL/></RichType>"
+      "</RichTypesInfo>",
+      "<RichTypesInfo><RichType id=\"0\">text<BOOL/></RichType>"
+      "</RichTypesInfo>",
+      "<RichTypesInfo/><RichTypesInfo/>",
+  };
+  for (const auto& xml : invalid) {
+    EXPECT_THROW(BTypeFactory::readXMLRichTypesInfo(xml),
+                 BTypeFactory::Exception)
+        << xml;
+  }
+  EXPECT_TRUE(BTypeFactory::readXMLRichTypesInfo("<RichTypesInfo/>").empty());
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}